@@ -0,0 +1,437 @@
+// bench: per-primitive microbenchmarks for the shared BigInt library, one
+// case per operation and operand size, reported as JSON so runs from two
+// commits can be diffed.
+//
+//   bench [--bits 64,256,...] [--only mul,gcd,...] [--time seconds] [--out file]
+//         [--perf on|off]
+//   bench --tune [--time seconds]      crossovers between the bigmul.h and
+//                                      bigdiv.h tiers
+//
+// Every case is timed in-process on fixed pseudo-random operands (same seed
+// every run): the iteration count is doubled until one batch takes a fifth of
+// --time, then five batches are timed and the median is reported (a call
+// slower than --time on its own is reported from that one run). Cycles are
+// TSC ticks (constant rate, not core clock) on x86 and 0 elsewhere.
+//
+// Where the kernel allows perf_event_open (perf.h), each result also gets
+// the hardware counts per op over the five timed batches: core cycles,
+// instructions, IPC, branch misses and L1D read misses. Without them (or
+// with --perf off) those fields are left out and the JSON says why.
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+#include "../common/bigint.h"
+#include "../common/rsa.h"
+#include "../common/modexp.h"
+#include "../common/batchrsa.h"
+#include "../common/blinding.h"
+#include "perf.h"
+
+using namespace std;
+
+static uint64_t ticks() {
+#ifdef __x86_64__
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Random value of exactly `bits` bits (top bit set), odd if asked.
+static BigInt randomBits(mt19937_64& rng, int bits, bool odd) {
+    vector<uint32_t> w((bits + 31) / 32);
+    for (auto& x : w) x = (uint32_t)rng();
+    int top = (bits - 1) % 32;
+    w.back() &= top == 31 ? ~0u : (2u << top) - 1;
+    w.back() |= 1u << top;
+    if (odd) w[0] |= 1;
+    return BigInt::fromWords(w.data(), (int)w.size());
+}
+
+// Odd composite with no prime factor below 100, so isPrime gets past trial
+// division and pays for (usually) one Miller-Rabin round.
+static BigInt hardComposite(mt19937_64& rng, int bits) {
+    for (;;) {
+        BigInt n = randomBits(rng, bits, true);
+        if (trialDivision(n) && !millerRabin(n, 1)) return n;
+    }
+}
+
+// Prime of exactly `bits` bits, the top two set, with gcd(e, p - 1) == 1.
+static BigInt randomPrime(mt19937_64& rng, int bits, const BigInt& e) {
+    for (;;) {
+        BigInt p = randomBits(rng, bits, true);
+        p.setBit(bits - 2);
+        if (isPrime(p) && gcd(e, p - BigInt(1)).isOne()) return p;
+    }
+}
+
+// Fiat batch of b private operations under one key with exponents 3, 5, 7,
+// ... and its ciphertexts; built on first use, i.e. in the warm-up call.
+struct BatchCase {
+    uint64_t seed;
+    int bits, b;
+    unique_ptr<batchrsa::Batch> batch;
+    vector<BigInt> c, m;
+
+    batchrsa::Batch& get() {
+        if (batch) return *batch;
+        static const uint64_t primes[] = {3, 5, 7, 11, 13, 17, 19, 23};
+        mt19937_64 rng(seed);
+        vector<BigInt> e;
+        BigInt all(1);
+        for (int i = 0; i < b; ++i) { e.emplace_back(primes[i]); all = all * e.back(); }
+        BigInt p = randomPrime(rng, bits - bits / 2, all), q = randomPrime(rng, bits / 2, all);
+        batch.reset(new batchrsa::Batch(p, q, e));
+        for (int i = 0; i < b; ++i)
+            c.push_back(powerModBest(randomBits(rng, bits - 1, false), e[i], batch->modulus()));
+        return *batch;
+    }
+};
+
+// RSA key with e = 65537 and a message below n, for the private-operation
+// cases; made on first use like BatchCase.
+struct KeyCase {
+    uint64_t seed;
+    int bits;
+    BigInt n, e, d, x;
+
+    const KeyCase& get() {
+        if (!n.isZero()) return *this;
+        mt19937_64 rng(seed);
+        e = BigInt(65537);
+        BigInt p = randomPrime(rng, bits - bits / 2, e), q = randomPrime(rng, bits / 2, e);
+        d = modInverse(e, phiEuler(p, q));
+        x = randomBits(rng, bits - 1, false);
+        n = p * q;
+        return *this;
+    }
+};
+
+struct Result {
+    string name;
+    int bits;
+    uint64_t iterations;                           // per timed batch
+    int samples;
+    double nsPerOp, nsMin, cyclesPerOp;
+    perf::Sample hw;                               // per op, over the timed batches
+};
+
+static perf::Counters* hwCounters = nullptr;       // null: not measuring
+
+// op() returns something derived from its result so the call cannot be
+// dropped; the values are folded into a volatile sink.
+static Result measure(const string& name, int bits, double seconds, const function<uint64_t()>& op) {
+    using clk = chrono::steady_clock;
+    const int SAMPLES = 5;
+    volatile uint64_t sink = op();                 // warm-up: pool, caches
+    vector<double> ns, cyc;
+    perf::Sample hw;
+    uint64_t hwOps = 0;
+    auto batch = [&](uint64_t n) {
+        if (hwCounters) hwCounters->start();
+        auto t0 = clk::now();
+        uint64_t c0 = ticks();
+        for (uint64_t i = 0; i < n; ++i) sink = sink + op();
+        uint64_t c1 = ticks();
+        ns.push_back(chrono::duration<double, nano>(clk::now() - t0).count() / n);
+        cyc.push_back((double)(c1 - c0) / n);
+        if (hwCounters) {
+            perf::Sample s = hwCounters->stop();
+            for (int e = 0; e < perf::EVENTS; ++e) { hw.count[e] += s.count[e]; hw.valid[e] = s.valid[e]; }
+            hwOps += n;
+        }
+        return ns.back() * n * 1e-9;
+    };
+    auto perOp = [&] {
+        for (int e = 0; e < perf::EVENTS; ++e) hw.count[e] /= max<uint64_t>(hwOps, 1);
+        return hw;
+    };
+    uint64_t n = 1;
+    for (;; n *= 2) {
+        double took = batch(n);
+        if (took >= seconds / SAMPLES || n >= (1ull << 40)) {
+            // A single call longer than the whole budget: that run is the
+            // only sample rather than five more of the same.
+            if (n == 1 && took >= seconds) return Result{name, bits, 1, 1, ns[0], ns[0], cyc[0], perOp()};
+            break;
+        }
+    }
+    ns.clear(); cyc.clear();
+    hw = perf::Sample(); hwOps = 0;
+    for (int s = 0; s < SAMPLES; ++s) batch(n);
+    (void)sink;
+    sort(ns.begin(), ns.end());
+    sort(cyc.begin(), cyc.end());
+    return Result{name, bits, n, SAMPLES, ns[SAMPLES / 2], ns[0], cyc[SAMPLES / 2], perOp()};
+}
+
+static uint64_t fold(const BigInt& x) { return x.words()[0] ^ (uint64_t)x.wordCount() << 32; }
+
+// Cases for one operand size: name -> operation. Operands are built once,
+// outside the timed loop.
+static void addCases(vector<pair<string, function<uint64_t()>>>& cases, mt19937_64& rng, int bits) {
+    auto a = make_shared<BigInt>(randomBits(rng, bits, false));
+    auto b = make_shared<BigInt>(randomBits(rng, bits, false));
+    auto N = make_shared<BigInt>(randomBits(rng, bits, true));
+    auto x = make_shared<BigInt>(*a % *N);
+    auto y = make_shared<BigInt>(*b % *N);
+    auto k = make_shared<BigInt>(randomBits(rng, bits, false));
+    auto wide = make_shared<BigInt>(*a * *b);      // 2*bits / bits division
+    auto c = make_shared<BigInt>(hardComposite(rng, bits));
+    auto text = make_shared<string>(bits / 4 + 8, '\0');
+    text->resize(hexcodec::encode(a->words(), a->wordCount(), &(*text)[0]));
+    auto buf = make_shared<string>(8 * (size_t)a->wordCount(), '\0');
+
+    cases.emplace_back("mul", [=] { return fold(*a * *b); });
+    cases.emplace_back("square", [=] { return fold(a->square()); });
+    cases.emplace_back("divmod", [=] { BigInt q, r; wide->divMod(*N, q, r); return fold(q) ^ fold(r); });
+    cases.emplace_back("mulmod", [=] { return fold(BigInt::mulMod(*x, *y, *N)); });
+    cases.emplace_back("powmod_65537", [=] { return fold(powerModBest(*x, BigInt(65537), *N)); });
+    cases.emplace_back("powmod", [=] { return fold(powerModBest(*x, *k, *N)); });
+    cases.emplace_back("gcd", [=] { return fold(gcd(*a, *b)); });
+    cases.emplace_back("modinv", [=] { return fold(modInverse(*x, *N)); });
+    cases.emplace_back("isprime", [=] { return (uint64_t)isPrime(*c); });
+    // x^d mod n plain, blinded from the thread's context, and blinded with a
+    // fresh r^e and r^-1 every call
+    if (bits >= 256 && bits <= 4096) {
+        auto kc = make_shared<KeyCase>(KeyCase{rng(), bits, {}, {}, {}, {}});
+        cases.emplace_back("private", [=] { const KeyCase& k = kc->get(); return fold(powerModBest(k.x, k.d, k.n)); });
+        cases.emplace_back("private_blinded", [=] {
+            const KeyCase& k = kc->get();
+            return fold(blinding::apply(blinding::local(k.n, k.e), k.x,
+                                        [&](const BigInt& v) { return powerModBest(v, k.d, k.n); }));
+        });
+        cases.emplace_back("private_fresh_blind", [=] {
+            const KeyCase& k = kc->get();
+            blinding::Context fresh(k.n, k.e);
+            return fold(blinding::apply(fresh, k.x, [&](const BigInt& v) { return powerModBest(v, k.d, k.n); }));
+        });
+    }
+    // b private operations, batched against one CRT decryption each
+    if (bits >= 256 && bits <= 4096) {
+        for (int b : {4, 8}) {
+            auto bc = make_shared<BatchCase>(BatchCase{rng(), bits, b, nullptr, {}, {}});
+            string x = "_x" + to_string(b);
+            cases.emplace_back("batch_rsa" + x, [=] { bc->get().decrypt(bc->c, bc->m); return fold(bc->m[0]); });
+            cases.emplace_back("crt_rsa" + x, [=] {
+                uint64_t f = 0;
+                for (int i = 0; i < b; ++i) f ^= fold(bc->get().decryptOne(i, bc->c[i]));
+                return f;
+            });
+        }
+    }
+    cases.emplace_back("hex_decode", [=] { return fold(BigInt(text->data(), text->size())); });
+    cases.emplace_back("hex_encode", [=] {
+        return (uint64_t)hexcodec::encode(a->words(), a->wordCount(), &(*buf)[0]) ^ (uint8_t)(*buf)[0];
+    });
+}
+
+static vector<string> split(const string& s) {
+    vector<string> out;
+    for (size_t i = 0; i <= s.size();) {
+        size_t e = s.find(',', i);
+        if (e == string::npos) e = s.size();
+        if (e > i) out.push_back(s.substr(i, e - i));
+        i = e + 1;
+    }
+    return out;
+}
+
+// ", \"hw\": {...}" with the per-op counts the kernel gave and the IPC, or
+// nothing without counters.
+static string hwJson(const perf::Sample& hw) {
+    ostringstream os;
+    for (int e = 0; e < perf::EVENTS; ++e)
+        if (hw.valid[e]) os << (os.tellp() ? ", " : "") << '"' << perf::eventName(e) << "_per_op\": " << hw.count[e];
+    if (hw.valid[perf::CYCLES] && hw.valid[perf::INSTRUCTIONS] && hw.count[perf::CYCLES] > 0)
+        os << ", \"ipc\": " << hw.count[perf::INSTRUCTIONS] / hw.count[perf::CYCLES];
+    return os.tellp() ? ", \"hw\": {" + os.str() + "}" : "";
+}
+
+static void writeJson(ostream& os, const vector<Result>& results, double seconds, const string& perfNote) {
+    time_t now = time(0);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    os << "{\n  \"timestamp\": \"" << stamp << "\",\n"
+#ifdef __VERSION__
+       << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+#endif
+       << "  \"row_kernel\": \""
+       << (BigInt::pickRowKernel() == BigInt::mulAddRowPortable ? "portable" : "adx") << "\",\n"
+       << "  \"ifma52\": " << (Ifma52Montgomery::available() ? "true" : "false") << ",\n"
+       << "  \"seconds_per_case\": " << seconds << ",\n"
+       << "  \"perf_counters\": \"" << perfNote << "\",\n"
+       << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        os << "    {\"op\": \"" << r.name << "\", \"bits\": " << r.bits
+           << ", \"iterations\": " << r.iterations << ", \"samples\": " << r.samples
+           << ", \"ns_per_op\": " << r.nsPerOp << ", \"ns_min\": " << r.nsMin
+           << ", \"cycles_per_op\": " << r.cyclesPerOp
+           << ", \"ops_per_sec\": " << (r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0) << hwJson(r.hw) << '}'
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+// Crossovers for bigmul.h and bigdiv.h: for each tier, the smallest
+// balanced size (limbs) from which one top-level step of it beats the tier
+// below on two sizes in a row, with the tiers tuned so far used underneath.
+// Multiplication comes first, so the division tiers are timed on the tuned
+// products. Every result is checked on the way: products against
+// schoolbook, 2n/n divisions by q * d + r == a, r < d.
+static int tune(double seconds) {
+    const int NONE = 1 << 30;
+    bigmul::Thresholds& th = bigmul::thresholds;
+    th.karatsuba = th.toom3 = th.ntt = NONE;
+    mt19937_64 rng(7);
+    int bad = 0;
+    ostringstream points;
+    auto point = [&](const char* key, int tier, int n, double tLo, double tHi) {
+        points << (points.tellp() > 0 ? ",\n" : "") << "    {\"" << key << "\": " << tier << ", \"limbs\": " << n
+               << ", \"ns_lower\": " << tLo << ", \"ns\": " << tHi << '}';
+    };
+    // Two wins in a row at `first` and the next size end the search.
+    auto cross = [&](int from, int to, double growth, function<pair<double, double>(int)> timeAt) {
+        int wins = 0, first = NONE;
+        for (int n = from; n <= to; n = max(n + 1, (int)(n * growth))) {
+            pair<double, double> t = timeAt(n);
+            if (t.second < t.first) { if (wins++ == 0) first = n; if (wins == 2) return first; }
+            else { wins = 0; first = NONE; }
+        }
+        return first;
+    };
+    auto mulAt = [&](bigmul::Tier lo, bigmul::Tier hi) {
+        return [&, lo, hi](int n) {
+            vector<uint32_t> a(n), b(n), r(2 * n), want(2 * n);
+            for (auto& x : a) x = (uint32_t)rng();
+            for (auto& x : b) x = (uint32_t)rng();
+            BigInt::mulWords(want.data(), a.data(), n, b.data(), n);
+            bigmul::mul(r.data(), a.data(), n, b.data(), n, hi);
+            if (r != want) { ++bad; cerr << "tier " << hi << " mismatch at " << n << " limbs\n"; }
+            auto run = [&](bigmul::Tier t) {
+                return measure("", n, seconds, [&] { bigmul::mul(r.data(), a.data(), n, b.data(), n, t); return (uint64_t)r[0]; }).nsPerOp;
+            };
+            double tLo = run(lo), tHi = run(hi);
+            cerr << "limbs=" << n << " tier" << lo << "=" << tLo << "ns tier" << hi << "=" << tHi << "ns\n";
+            point("tier", hi, n, tLo, tHi);
+            return make_pair(tLo, tHi);
+        };
+    };
+    th.karatsuba = cross(8, 160, 1.1, mulAt(bigmul::SCHOOLBOOK, bigmul::KARATSUBA));
+    th.toom3 = cross(40, 1200, 1.15, mulAt(bigmul::KARATSUBA, bigmul::TOOM3));
+    th.ntt = cross(200, 60000, 1.2, mulAt(bigmul::TOOM3, bigmul::NTT));
+
+    // Division: while `bz` is searched it is set to the size at hand, so
+    // Burnikel-Ziegler takes one step down to Knuth. `cached` times a
+    // Reciprocal built before the clock starts, against Burnikel-Ziegler
+    // like `newton` (which builds one per call).
+    bigdiv::Thresholds& dt = bigdiv::thresholds;
+    dt.bz = dt.newton = dt.cached = NONE;
+    auto divAt = [&](bigdiv::Method lo, bigdiv::Method hi, bool cached) {
+        return [&, lo, hi, cached](int n) {
+            if (hi == bigdiv::BURNIKEL_ZIEGLER) dt.bz = n;
+            vector<uint32_t> w(3 * n);
+            for (auto& x : w) x = (uint32_t)rng();
+            w[n - 1] |= 1u;
+            BigInt d = BigInt::fromWords(w.data(), n), a = BigInt::fromWords(w.data() + n, 2 * n), q, r;
+            bigdiv::Reciprocal rec(d);
+            auto divide = [&](bigdiv::Method m) {
+                if (cached && m == hi) rec.divMod(a, q, r); else bigdiv::divMod(a, d, q, r, m);
+                return (uint64_t)q.words()[0];
+            };
+            divide(hi);
+            if (!(r < d) || !(q * d + r == a)) { ++bad; cerr << "method " << hi << " wrong at " << n << " limbs\n"; }
+            double tLo = measure("", n, seconds, [&] { return divide(lo); }).nsPerOp;
+            double tHi = measure("", n, seconds, [&] { return divide(hi); }).nsPerOp;
+            cerr << "limbs=" << n << " method" << lo << "=" << tLo << "ns method" << hi << (cached ? "(cached)" : "")
+                 << "=" << tHi << "ns\n";
+            point(cached ? "method_cached" : "method", hi, n, tLo, tHi);
+            return make_pair(tLo, tHi);
+        };
+    };
+    dt.bz = cross(16, 400, 1.1, divAt(bigdiv::KNUTH, bigdiv::BURNIKEL_ZIEGLER, false));
+    dt.cached = cross(16, 20000, 1.15, divAt(bigdiv::BURNIKEL_ZIEGLER, bigdiv::NEWTON, true));
+    dt.newton = cross(64, 60000, 1.2, divAt(bigdiv::BURNIKEL_ZIEGLER, bigdiv::NEWTON, false));
+    cout << "{\n  \"karatsuba\": " << th.karatsuba << ", \"toom3\": " << th.toom3 << ", \"ntt\": " << th.ntt
+         << ",\n  \"bz\": " << dt.bz << ", \"newton\": " << dt.newton << ", \"cached\": " << dt.cached
+         << ",\n  \"mismatches\": " << bad << ",\n  \"points\": [\n" << points.str() << "\n  ]\n}\n";
+    return bad ? 1 : 0;
+}
+
+static int usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--bits 64,128,...] [--only op,...] [--time seconds] [--out file] [--perf on|off]\n"
+         << "       " << prog << " --tune [--time seconds per point]   (multiplication and division thresholds)\n"
+         << "ops: mul square divmod mulmod powmod_65537 powmod gcd modinv isprime\n"
+         << "     private private_blinded private_fresh_blind batch_rsa_x4 crt_rsa_x4 batch_rsa_x8\n"
+         << "     crt_rsa_x8 (those 256-4096 bits) hex_decode hex_encode\n";
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    vector<int> sizes = {64, 128, 256, 512, 1024, 2048, 4096, 8192};
+    vector<string> only;
+    double seconds = 0.5;
+    const char* outPath = nullptr;
+    bool tuning = false, hw = true;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--tune") { tuning = true; continue; }
+        if (i + 1 == argc) return usage(argv[0]);
+        string val = argv[++i];
+        if (arg == "--bits") {
+            sizes.clear();
+            for (auto& s : split(val)) sizes.push_back(atoi(s.c_str()));
+            if (sizes.empty() || *min_element(sizes.begin(), sizes.end()) < 8) return usage(argv[0]);
+        } else if (arg == "--only") only = split(val);
+        else if (arg == "--time") { seconds = atof(val.c_str()); if (seconds <= 0) return usage(argv[0]); }
+        else if (arg == "--out") outPath = argv[i];
+        else if (arg == "--perf" && (val == "on" || val == "off")) hw = val == "on";
+        else return usage(argv[0]);
+    }
+
+    if (tuning) return tune(seconds / 10);
+
+    perf::Counters counters;
+    string perfNote = !hw ? "off" : counters.available() ? "on" : "unavailable (" + counters.reason() + ")";
+    if (hw && counters.available()) hwCounters = &counters;
+    else if (hw) cerr << "hardware counters " << perfNote << ", timing only\n";
+
+    mt19937_64 rng(2024);
+    vector<Result> results;
+    for (int bits : sizes) {
+        vector<pair<string, function<uint64_t()>>> cases;
+        addCases(cases, rng, bits);
+        for (auto& c : cases) {
+            if (!only.empty() && find(only.begin(), only.end(), c.first) == only.end()) continue;
+            results.push_back(measure(c.first, bits, seconds, c.second));
+            const Result& r = results.back();
+            cerr << r.name << " bits=" << bits << " ns/op=" << r.nsPerOp << " cycles/op=" << r.cyclesPerOp;
+            if (r.hw.valid[perf::CYCLES] && r.hw.valid[perf::INSTRUCTIONS] && r.hw.count[perf::CYCLES] > 0)
+                cerr << " ipc=" << r.hw.count[perf::INSTRUCTIONS] / r.hw.count[perf::CYCLES];
+            if (r.hw.valid[perf::BRANCH_MISSES]) cerr << " branch-misses/op=" << r.hw.count[perf::BRANCH_MISSES];
+            if (r.hw.valid[perf::L1D_MISSES]) cerr << " l1d-misses/op=" << r.hw.count[perf::L1D_MISSES];
+            cerr << '\n';
+        }
+    }
+    if (!outPath) { writeJson(cout, results, seconds, perfNote); return 0; }
+    ofstream out(outPath);
+    writeJson(out, results, seconds, perfNote);
+    if (!out.flush()) { cerr << "Cannot write output: " << outPath << '\n'; return 1; }
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Hardware counters for bench through Linux perf_event_open: core cycles,
+// instructions retired, branch misses and L1D read misses of this thread,
+// user space only. Each event is opened on its own, so one the PMU lacks
+// (or a VM does not expose) only drops that column. When the kernel refuses
+// all of them (perf_event_paranoid, no PMU, not Linux) available() is false
+// and reason() says why. Counts are scaled by enabled/running time when the
+// kernel multiplexes the counters.
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, EVENTS };
+
+inline const char* eventName(int e) {
+    static const char* names[EVENTS] = {"cycles", "instructions", "branch_misses", "l1d_misses"};
+    return names[e];
+}
+
+struct Sample {
+    double count[EVENTS] = {};
+    bool valid[EVENTS] = {};
+};
+
+class Counters {
+public:
+    Counters() {
+#ifdef __linux__
+        static const uint64_t config[EVENTS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        int err = 0;
+        for (int e = 0; e < EVENTS; ++e) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = e == L1D_MISSES ? PERF_TYPE_HW_CACHE : PERF_TYPE_HARDWARE;
+            attr.config = config[e];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[e] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd[e] < 0 && !err) err = errno;
+        }
+        if (!available()) why = std::string("perf_event_open: ") + strerror(err);
+#else
+        why = "perf_event_open needs Linux";
+#endif
+    }
+    ~Counters() {
+#ifdef __linux__
+        for (int f : fd) if (f >= 0) close(f);
+#endif
+    }
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    bool available() const {
+        for (int f : fd) if (f >= 0) return true;
+        return false;
+    }
+    const std::string& reason() const { return why; }
+
+    void start() {
+#ifdef __linux__
+        for (int f : fd) if (f >= 0) { ioctl(f, PERF_EVENT_IOC_RESET, 0); ioctl(f, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+    Sample stop() {
+        Sample s;
+#ifdef __linux__
+        for (int f : fd) if (f >= 0) ioctl(f, PERF_EVENT_IOC_DISABLE, 0);
+        for (int e = 0; e < EVENTS; ++e) {
+            uint64_t v[3];                         // value, time enabled, time running
+            if (fd[e] < 0 || read(fd[e], v, sizeof v) != (ssize_t)sizeof v || v[2] == 0) continue;
+            s.count[e] = (double)v[0] * ((double)v[1] / (double)v[2]);
+            s.valid[e] = true;
+        }
+#endif
+        return s;
+    }
+
+private:
+    int fd[EVENTS] = {-1, -1, -1, -1};
+    std::string why;
+};
+
+} // namespace perf
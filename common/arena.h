@@ -0,0 +1,283 @@
+// Per-thread size-class pool for BigInt limb storage, so temporaries in
+// divMod, modInverse, powerMod and friends never reach malloc once the pool
+// is warm.
+//
+// Blocks of 8, 16, ..., 1024 limbs (plus a 16-byte header) are carved from
+// 256 KiB chunks with a bump pointer and recycled through per-class free
+// lists. A Scope marks a reset point around a top-level operation: blocks
+// carved inside it belong to the scope, and when the scope closes with none
+// of them still live, the bump pointer rewinds to where the scope began.
+// Blocks still live (results, values stored by the caller) are handed down
+// to the enclosing level instead, so nothing is ever freed from under a
+// value. Requests above 1024 limbs, past the per-thread limit or during
+// thread teardown go to the heap and are counted.
+//
+// A block freed on another thread is pushed onto its owner's lock-free
+// remote list and recycled by the owner on its next miss or scope exit.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+namespace arena {
+
+constexpr int CLASSES = 8;                         // 8 << c limbs, c < CLASSES
+constexpr size_t CHUNK = 256 << 10;
+constexpr size_t LIMIT = 64 << 20;                 // chunk bytes per thread
+constexpr int MAX_DEPTH = 16;
+
+inline int classFor(int words) {
+    int c = 0;
+    while (c < CLASSES && (8 << c) < words) ++c;
+    return c;                                      // CLASSES: too big for the pool
+}
+
+struct Stats {
+    uint64_t allocations = 0, heapFallbacks = 0, rewinds = 0;
+    size_t inUse = 0;                              // bytes in live pool blocks
+    size_t peak = 0;                               // max of inUse
+    size_t highWater = 0;                          // furthest the bump pointer got
+    size_t reserved = 0;                           // chunk bytes
+};
+
+class Pool;
+
+struct alignas(16) Header {
+    Pool* owner;                                   // nullptr: heap block
+    uint32_t offset;
+    uint16_t chunk;
+    uint8_t cls;
+};
+static_assert(sizeof(Header) == 16, "header layout");
+
+inline Header*& nextOf(Header* h) { return *(Header**)(h + 1); }
+
+class Pool {
+public:
+    Pool() = default;
+    ~Pool() { for (char* c : chunks) ::operator delete(c); }
+
+    // Zeroing is the caller's job; cap gets the class size in limbs.
+    uint32_t* allocate(int words, int& cap) {
+        ++st.allocations;
+        int c = classFor(words);
+        if (c == CLASSES) return heapBlock(words, cap);
+        Header* h = nullptr;
+        int level = depth;
+        for (;;) {
+            for (level = depth; level >= 0 && !(h = pop(levels[level].free[c])); --level) {}
+            if (h || !remote.load(std::memory_order_relaxed)) break;
+            drainRemote();
+        }
+        if (!h) {
+            if (!(h = carve(c))) return heapBlock(words, cap);
+            level = depth;
+        }
+        ++levels[level].live;
+        st.inUse += bytes(c);
+        st.peak = std::max(st.peak, st.inUse);
+        cap = 8 << c;
+        return (uint32_t*)(h + 1);
+    }
+
+    // h->owner == this, on the owning thread
+    void release(Header* h) {
+        Level& l = levels[levelOf(h)];
+        push(l.free[h->cls], h);
+        --l.live;
+        st.inUse -= bytes(h->cls);
+    }
+
+    void pushRemote(Header* h) {
+        if (orphaned.load(std::memory_order_acquire)) { dropOrphan(); return; }
+        Header* head = remote.load(std::memory_order_relaxed);
+        do nextOf(h) = head;
+        while (!remote.compare_exchange_weak(head, h, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void enter() {
+        if (depth == MAX_DEPTH) { ++overflow; return; }
+        levels[++depth] = Level();
+        levels[depth].mark = position();
+    }
+
+    void leave() {
+        if (overflow) { --overflow; return; }
+        if (depth == 0) return;
+        drainRemote();
+        Level& top = levels[depth--];
+        if (top.live == 0) {
+            cur = (int)(top.mark >> 32) - 1;
+            off = (uint32_t)top.mark;
+            ++st.rewinds;
+            return;
+        }
+        Level& below = levels[depth];
+        below.live += top.live;
+        for (int c = 0; c < CLASSES; ++c) {
+            FreeList& from = top.free[c];
+            FreeList& to = below.free[c];
+            if (!from.head) continue;
+            nextOf(from.tail) = to.head;
+            if (!to.head) to.tail = from.tail;
+            to.head = from.head;
+        }
+    }
+
+    // Thread exit: frees the pool now if nothing in it is live, otherwise
+    // when the last outstanding block comes back from another thread. (A
+    // block whose release races the hand-over may keep it alive for good.)
+    void retire() {
+        drainRemote();
+        size_t live = 0;
+        for (int l = 0; l <= depth; ++l) live += levels[l].live;
+        if (live == 0) { delete this; return; }
+        orphanLive.store(live, std::memory_order_relaxed);
+        orphaned.store(true, std::memory_order_release);
+        for (Header* h = remote.exchange(nullptr, std::memory_order_acquire); h;) {
+            Header* n = nextOf(h);
+            if (dropOrphan()) return;
+            h = n;
+        }
+    }
+
+    Stats stats() const {
+        Stats s = st;
+        s.reserved = chunks.size() * CHUNK;
+        return s;
+    }
+
+private:
+    struct FreeList { Header* head = nullptr; Header* tail = nullptr; };
+    struct Level {
+        uint64_t mark = 0;                         // (chunk + 1) << 32 | offset
+        size_t live = 0;
+        FreeList free[CLASSES];
+    };
+
+    static size_t bytes(int c) { return sizeof(Header) + 4 * (size_t)(8 << c); }
+
+    static Header* pop(FreeList& l) {
+        Header* h = l.head;
+        if (h) l.head = nextOf(h);
+        return h;
+    }
+    static void push(FreeList& l, Header* h) {
+        nextOf(h) = l.head;
+        if (!l.head) l.tail = h;
+        l.head = h;
+    }
+
+    uint64_t position() const { return ((uint64_t)(cur + 1) << 32) | off; }
+    int levelOf(const Header* h) const {
+        uint64_t pos = ((uint64_t)(h->chunk + 1) << 32) | h->offset;
+        int l = depth;
+        while (l > 0 && pos < levels[l].mark) --l;
+        return l;
+    }
+
+    Header* carve(int c) {
+        size_t need = bytes(c);
+        if (cur < 0 || off + need > CHUNK) {
+            if ((size_t)(cur + 1) == chunks.size()) {
+                if ((chunks.size() + 1) * CHUNK > LIMIT || chunks.size() == 0xFFFF) return nullptr;
+                chunks.push_back((char*)::operator new(CHUNK));
+            }
+            ++cur; off = 0;
+        }
+        Header* h = (Header*)(chunks[cur] + off);
+        h->owner = this; h->chunk = (uint16_t)cur; h->offset = off; h->cls = (uint8_t)c;
+        off += (uint32_t)need;
+        st.highWater = std::max(st.highWater, (size_t)cur * CHUNK + off);
+        return h;
+    }
+
+    uint32_t* heapBlock(int words, int& cap) {
+        ++st.heapFallbacks;
+        Header* h = (Header*)::operator new(sizeof(Header) + 4 * (size_t)words);
+        h->owner = nullptr;
+        cap = words;
+        return (uint32_t*)(h + 1);
+    }
+
+    bool dropOrphan() {
+        if (orphanLive.fetch_sub(1, std::memory_order_acq_rel) != 1) return false;
+        delete this;
+        return true;
+    }
+
+    void drainRemote() {
+        for (Header* h = remote.exchange(nullptr, std::memory_order_acquire); h;) {
+            Header* n = nextOf(h);
+            release(h);
+            h = n;
+        }
+    }
+
+    std::vector<char*> chunks;
+    int cur = -1;                                  // chunk the bump pointer is in
+    uint32_t off = 0;
+    Level levels[MAX_DEPTH + 1];
+    int depth = 0, overflow = 0;
+    Stats st;
+    std::atomic<Header*> remote{nullptr};
+    std::atomic<bool> orphaned{false};
+    std::atomic<size_t> orphanLive{0};
+};
+
+inline thread_local Pool* current = nullptr;
+inline thread_local bool retired = false;
+
+struct PoolOwner {
+    ~PoolOwner() {
+        if (current) current->retire();
+        current = nullptr;
+        retired = true;
+    }
+};
+
+// This thread's pool; nullptr once the thread is tearing down.
+inline Pool* pool() {
+    if (!current && !retired) {
+        static thread_local PoolOwner owner;
+        (void)owner;
+        current = new Pool;
+    }
+    return current;
+}
+
+inline uint32_t* allocate(int words, int& cap) {
+    if (Pool* p = pool()) return p->allocate(words, cap);
+    Header* h = (Header*)::operator new(sizeof(Header) + 4 * (size_t)words);
+    h->owner = nullptr;
+    cap = words;
+    return (uint32_t*)(h + 1);
+}
+
+inline void release(uint32_t* p) {
+    if (!p) return;
+    Header* h = (Header*)p - 1;
+    if (!h->owner) ::operator delete(h);
+    else if (h->owner == current) h->owner->release(h);
+    else h->owner->pushRemote(h);
+}
+
+inline Stats stats() {
+    Pool* p = pool();
+    return p ? p->stats() : Stats();
+}
+
+// Reset point around one top-level operation.
+struct Scope {
+    Pool* p;
+    Scope() : p(pool()) { if (p) p->enter(); }
+    ~Scope() { if (p) p->leave(); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+};
+
+} // namespace arena
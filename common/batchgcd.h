@@ -0,0 +1,199 @@
+// Bernstein batch gcd: for every modulus N_i of a corpus, gcd(N_i, product
+// of all the others), in quasi-linear time instead of n^2 pairwise gcds.
+//
+//   product tree    level 0 = the moduli, level l+1 = products of pairs of
+//                   level l (an odd one out moves up unchanged); root P
+//   remainder tree  top down, r = (parent's r) mod child^2, starting from P,
+//                   so each leaf ends with P mod N_i^2
+//   leaves          g_i = gcd((P mod N_i^2) / N_i, N_i)
+//
+// Each level is computed by a pool of threads. Whenever the levels held in
+// memory exceed Options::memoryBytes, the finished product levels are
+// written to binary record files (common/binrec.h) under spillDir and read
+// back one at a time on the way down, so past the limit only the moduli,
+// the level being built and the one it is built from (or, going down, one
+// product level and two remainder levels) are resident.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "bigint.h"
+#include "rsa.h"
+#include "binrec.h"
+
+namespace batchgcd {
+
+struct Options {
+    int workers = 1;
+    size_t memoryBytes = size_t(1) << 30;
+    std::string spillDir = "/tmp";
+};
+
+struct Stats {
+    int levels = 0, spilled = 0;
+    size_t peakBytes = 0;                          // limb bytes of resident levels
+    double productSeconds = 0, remainderSeconds = 0, leafSeconds = 0;
+};
+
+// f(i) for i in [0, n) on up to `workers` threads, items handed out one at a
+// time (sizes within a level are close, the counts near the root are small).
+template <class F>
+void parallelFor(size_t n, int workers, F&& f) {
+    size_t t = std::min<size_t>(std::max(workers, 1), n);
+    if (t <= 1) { for (size_t i = 0; i < n; ++i) f(i); return; }
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> pool;
+    for (size_t w = 0; w < t; ++w) pool.emplace_back([&] {
+        for (size_t i; (i = next++) < n;) f(i);
+    });
+    for (auto& th : pool) th.join();
+}
+
+inline size_t bytesOf(const std::vector<BigInt>& v) {
+    size_t b = 0;
+    for (auto& x : v) b += 4 * (size_t)x.wordCount();
+    return b;
+}
+
+// One product level, in memory or in a spill file.
+class Level {
+public:
+    std::vector<BigInt> nums;
+
+    size_t bytes() const { return resident ? held : 0; }
+
+    void built() { resident = true; held = bytesOf(nums); }
+
+    bool spill(const std::string& dir, int index) {
+        path = dir + "/batchgcd." + std::to_string(getpid()) + "." + std::to_string(index) + ".bin";
+        binrec::NumberOutput out;
+        if (!out.open(path.c_str(), true, nums.size())) return false;
+        for (auto& x : nums) out.write(x);
+        if (!out.close()) return false;
+        count = nums.size();
+        std::vector<BigInt>().swap(nums);
+        resident = false;
+        return true;
+    }
+
+    bool load() {
+        if (resident) return true;
+        binrec::NumberInput in;
+        if (!in.open(path.c_str())) return false;
+        nums.resize(count);
+        for (auto& x : nums) if (!in.read(x)) return false;
+        resident = true;
+        std::remove(path.c_str());
+        path.clear();
+        return true;
+    }
+
+    void drop() { std::vector<BigInt>().swap(nums); resident = false; held = 0; }
+
+    ~Level() { if (!path.empty()) std::remove(path.c_str()); }
+
+private:
+    std::string path;
+    size_t count = 0, held = 0;
+    bool resident = false;
+};
+
+// g[i] = gcd(moduli[i], product of the other moduli): 1 when N_i shares no
+// factor with the rest, N_i itself when both of its factors are shared (or
+// it occurs twice). Every modulus must be >= 2. False if a spill file
+// cannot be written or read back.
+inline bool run(const std::vector<BigInt>& moduli, std::vector<BigInt>& g, const Options& opt,
+                Stats* stats = nullptr) {
+    typedef std::chrono::steady_clock clk;
+    auto since = [](clk::time_point t) { return std::chrono::duration<double>(clk::now() - t).count(); };
+    Stats st;
+    g.assign(moduli.size(), BigInt(1));
+    if (moduli.size() < 2) { if (stats) *stats = st; return true; }
+
+    // tree[l] holds level l + 1; level 0 is `moduli` itself. Reserved up
+    // front: levels are built in place and never move.
+    std::vector<Level> tree;
+    tree.reserve(64);
+    auto level = [&](size_t l) -> const std::vector<BigInt>& { return l ? tree[l - 1].nums : moduli; };
+    auto resident = [&] {
+        size_t b = bytesOf(moduli);
+        for (auto& l : tree) b += l.bytes();
+        st.peakBytes = std::max(st.peakBytes, b);
+        return b;
+    };
+
+    auto t0 = clk::now();
+    while (level(tree.size()).size() > 1) {
+        const std::vector<BigInt>& below = level(tree.size());
+        tree.emplace_back();
+        Level& up = tree.back();
+        up.nums.resize((below.size() + 1) / 2);
+        parallelFor(up.nums.size(), opt.workers, [&](size_t i) {
+            up.nums[i] = 2 * i + 1 < below.size() ? below[2 * i] * below[2 * i + 1] : below[2 * i];
+        });
+        up.built();
+        if (resident() > opt.memoryBytes) {
+            for (size_t l = 0; l + 1 < tree.size(); ++l)
+                if (tree[l].bytes()) {
+                    if (!tree[l].spill(opt.spillDir, (int)l + 1)) return false;
+                    ++st.spilled;
+                }
+        }
+    }
+    st.levels = (int)tree.size() + 1;
+    st.productSeconds = since(t0);
+
+    t0 = clk::now();
+    std::vector<BigInt> rem(std::move(tree.back().nums)), next;
+    tree.back().drop();
+    for (size_t l = tree.size(); l-- > 0;) {
+        if (l > 0) {
+            if (!tree[l - 1].load()) return false;
+            tree[l - 1].built();
+            resident();
+        }
+        const std::vector<BigInt>& nodes = level(l);
+        next.assign(nodes.size(), BigInt());
+        parallelFor(nodes.size(), opt.workers, [&](size_t i) {
+            arena::Scope scope;
+            next[i] = rem[i / 2] % nodes[i].square();
+        });
+        rem.swap(next);
+        std::vector<BigInt>().swap(next);
+        if (l > 0) tree[l - 1].drop();
+    }
+    st.remainderSeconds = since(t0);
+
+    t0 = clk::now();
+    parallelFor(moduli.size(), opt.workers, [&](size_t i) {
+        arena::Scope scope;
+        g[i] = gcd(rem[i] / moduli[i], moduli[i]);
+    });
+    st.leafSeconds = since(t0);
+    if (stats) *stats = st;
+    return true;
+}
+
+// Splits the moduli the tree left at g == N (both factors shared, or a
+// duplicate) by pairwise gcd. Whoever shares a factor with N_i has g != 1
+// too, so only the flagged moduli are tried. A duplicate keeps g == N.
+inline void resolveWhole(const std::vector<BigInt>& moduli, std::vector<BigInt>& g) {
+    std::vector<size_t> flagged;
+    for (size_t i = 0; i < moduli.size(); ++i) if (!g[i].isOne()) flagged.push_back(i);
+    for (size_t i : flagged) {
+        if (!(g[i] == moduli[i])) continue;
+        for (size_t j : flagged) {
+            if (j == i) continue;
+            BigInt d = gcd(moduli[i], moduli[j]);
+            if (!d.isOne() && !(d == moduli[i])) { g[i] = d; break; }
+        }
+    }
+}
+
+} // namespace batchgcd
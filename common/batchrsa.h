@@ -0,0 +1,165 @@
+// Fiat's batch RSA: b private operations m_i = c_i^(1/e_i) mod N under one
+// modulus, one per public exponent, for one full exponentiation plus small
+// ones. The e_i are pairwise coprime and coprime to phi(N); E is their
+// product.
+//
+//   up     product tree over the exponents, V = V_L^(E_R) * V_R^(E_L) at
+//          every node, so the root holds prod c_i^(E / e_i)
+//   root   M = V^(1/E): one CRT exponentiation with d = E^-1 mod phi(N)
+//   down   M = M_L * M_R is split with X_R = 0 mod E_L, 1 mod E_R and
+//          X_L = E + 1 - X_R (1 mod E_L, 0 mod E_R):
+//             M_R = M^X_R / (V_L^(X_R / E_L) * V_R^((X_R - 1) / E_R))
+//             M_L = M^X_L / (V_L^((X_L - 1) / E_L) * V_R^(X_L / E_R))
+//          The divisors depend only on the V, so all of them share one
+//          modInverse (Montgomery's trick), taken before the root.
+//
+// Every exponent outside the root is below E. Exponentiations go through
+// ModExpContext (modexp.h), inverses through modInverse (rsa.h).
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "bigint.h"
+#include "rsa.h"
+#include "modexp.h"
+
+namespace batchrsa {
+
+// p, q and d in CRT form: c^d mod pq as two half-size exponentiations,
+// recombined by Garner's formula. One private operation of the baseline.
+struct CrtKey {
+    BigInt p, q, dp, dq, qInv;
+    ModExpContext cp, cq;
+
+    CrtKey(const BigInt& p_, const BigInt& q_, const BigInt& d)
+        : p(p_), q(q_), dp(d % (p_ - BigInt(1))), dq(d % (q_ - BigInt(1))),
+          qInv(modInverse(q_ % p_, p_)), cp(p_), cq(q_) {}
+
+    BigInt power(const BigInt& c) const {
+        arena::Scope scope;
+        BigInt m1 = cp.powerMod(c % p, dp), m2 = cq.powerMod(c % q, dq), m2p = m2 % p;
+        BigInt h = m1 >= m2p ? m1 - m2p : m1 + p - m2p;
+        return m2 + BigInt::mulMod(h, qInv, p) * q;
+    }
+};
+
+class Batch {
+public:
+    // valid() is false unless p != q and the exponents are >= 3, pairwise
+    // coprime and coprime to (p - 1)(q - 1).
+    Batch(const BigInt& p, const BigInt& q, const std::vector<BigInt>& exponents) : n(p * q), ctx(n) {
+        int b = (int)exponents.size();
+        if (b == 0 || p == q || p < BigInt(3) || q < BigInt(3)) return;
+        BigInt phi = phiEuler(p, q);
+        for (int i = 0; i < b; ++i) {
+            if (exponents[i] < BigInt(3)) return;
+            for (int j = 0; j < i; ++j) if (!gcd(exponents[i], exponents[j]).isOne()) return;
+            BigInt d = modInverse(exponents[i], phi);
+            if (d.isZero()) return;
+            single.emplace_back(p, q, d);
+            nodes.emplace_back();
+            nodes.back().E = exponents[i];
+        }
+        // Pairs per level; an odd one out moves up unchanged.
+        std::vector<int> level(b);
+        for (int i = 0; i < b; ++i) level[i] = i;
+        while (level.size() > 1) {
+            std::vector<int> up, made;
+            for (size_t i = 0; i < level.size(); i += 2) {
+                if (i + 1 == level.size()) { up.push_back(level[i]); continue; }
+                Node t;
+                t.left = level[i]; t.right = level[i + 1];
+                const BigInt &el = nodes[t.left].E, &er = nodes[t.right].E;
+                t.E = el * er;
+                BigInt xr = el * modInverse(el % er, er), xl = t.E + BigInt(1) - xr;
+                t.toRight = Split{xr, xr / el, (xr - BigInt(1)) / er};
+                t.toLeft = Split{xl, (xl - BigInt(1)) / el, xl / er};
+                up.push_back((int)nodes.size()); made.push_back((int)nodes.size());
+                nodes.push_back(t);
+            }
+            levels.push_back(made);
+            level.swap(up);
+        }
+        root.reset(new CrtKey(p, q, modInverse(nodes.back().E, phi)));
+    }
+
+    bool valid() const { return root != nullptr; }
+    size_t size() const { return single.size(); }
+    const BigInt& modulus() const { return n; }
+
+    // c^(1/e_i) mod n on its own, the baseline.
+    BigInt decryptOne(size_t i, const BigInt& c) const { return single[i].power(c); }
+
+    // m[i] = c[i]^(1/e_i) mod n for c.size() == size(). A ciphertext sharing
+    // a factor with n leaves the divisors without an inverse; that batch
+    // falls back to one CRT operation per ciphertext.
+    void decrypt(const std::vector<BigInt>& c, std::vector<BigInt>& m) const {
+        size_t b = single.size();
+        m.assign(b, BigInt());
+        std::vector<BigInt> v(nodes.size()), M(nodes.size());
+        for (size_t i = 0; i < b; ++i) v[i] = c[i] % n;
+        for (auto& lv : levels)
+            for (int id : lv) {
+                const Node& t = nodes[id];
+                v[id] = BigInt::mulMod(ctx.powerMod(v[t.left], nodes[t.right].E),
+                                       ctx.powerMod(v[t.right], nodes[t.left].E), n);
+            }
+        // The divisors only involve the V, so all of them are inverted at once.
+        std::vector<BigInt> den(2 * nodes.size());
+        for (auto& lv : levels)
+            for (int id : lv) {
+                const Node& t = nodes[id];
+                den[2 * id] = BigInt::mulMod(ctx.powerMod(v[t.left], t.toLeft.fromLeft),
+                                             ctx.powerMod(v[t.right], t.toLeft.fromRight), n);
+                den[2 * id + 1] = BigInt::mulMod(ctx.powerMod(v[t.left], t.toRight.fromLeft),
+                                                 ctx.powerMod(v[t.right], t.toRight.fromRight), n);
+            }
+        if (!levels.empty() && !invertAll(den, 2 * b)) {
+            for (size_t i = 0; i < b; ++i) m[i] = single[i].power(c[i]);
+            return;
+        }
+        M[nodes.size() - 1] = root->power(v[nodes.size() - 1]);
+        for (size_t l = levels.size(); l-- > 0;)
+            for (int id : levels[l]) {
+                const Node& t = nodes[id];
+                M[t.left] = BigInt::mulMod(ctx.powerMod(M[id], t.toLeft.x), den[2 * id], n);
+                M[t.right] = BigInt::mulMod(ctx.powerMod(M[id], t.toRight.x), den[2 * id + 1], n);
+            }
+        for (size_t i = 0; i < b; ++i) m[i] = std::move(M[i]);
+    }
+
+private:
+    // M_child = M^x / (V_L^fromLeft * V_R^fromRight)
+    struct Split { BigInt x, fromLeft, fromRight; };
+    struct Node {
+        int left = -1, right = -1;
+        BigInt E;
+        Split toLeft, toRight;
+    };
+
+    BigInt n;
+    ModExpContext ctx;
+    std::vector<CrtKey> single;
+    std::vector<Node> nodes;                       // leaves first, root last
+    std::vector<std::vector<int>> levels;          // internal nodes, bottom up
+    std::unique_ptr<CrtKey> root;
+
+    // x[i] = x[i]^-1 mod n for i in [from, x.size()) with one modInverse:
+    // prefix products, the inverse of the last, then back down. False if
+    // one of them has no inverse.
+    bool invertAll(std::vector<BigInt>& x, size_t from) const {
+        std::vector<BigInt> prefix(x.size());
+        BigInt acc(1);
+        for (size_t i = from; i < x.size(); ++i) { prefix[i] = acc; acc = BigInt::mulMod(acc, x[i], n); }
+        BigInt inv = modInverse(acc, n);
+        if (inv.isZero()) return false;
+        for (size_t i = x.size(); i-- > from;) {
+            BigInt xi = BigInt::mulMod(inv, prefix[i], n);
+            inv = BigInt::mulMod(inv, x[i], n);
+            x[i] = std::move(xi);
+        }
+        return true;
+    }
+};
+
+} // namespace batchrsa
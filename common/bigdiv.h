@@ -0,0 +1,288 @@
+// Size-tiered division behind BigInt::divMod (single-limb divisors stay in
+// bigint.h):
+//
+//   Knuth D      schoolbook long division, one quotient limb per row, the
+//                estimate from the top two limbs off by at most 2
+//   Burnikel-    divide-and-conquer: a 2n/n division is two 3n/2n steps,
+//   Ziegler      each one n/(n/2) division and an n/2 x n/2 product, so
+//                the cost follows the multiplication tiers of bigmul.h
+//   Newton       B^2n / d by Newton iteration at doubling precision,
+//                then every n-limb slice of the dividend is a Barrett step
+//                of two products
+//
+// A reciprocal outlives its division: a divisor that comes by again soon
+// after on the same thread gets one, kept in a small per-thread cache, so
+// `x % n` with a fixed large n costs about three multiplications.
+// Reciprocal can also be held directly.
+//
+// Tiers switch on the divisor's limb count; the quotient must be at least
+// `bz` limbs for anything but Knuth. Defaults from `bench --tune`.
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "arena.h"
+#include "bigint.h"
+#include "bigmul.h"
+
+namespace bigdiv {
+
+struct Thresholds {
+    int bz = 120;                                  // limbs of the divisor
+    int newton = 40000;                            // reciprocal built for one division
+    int cached = 100;                              // reciprocal already built
+};
+inline Thresholds thresholds;
+
+enum Method { AUTO, KNUTH, BURNIKEL_ZIEGLER, NEWTON };
+
+// Divisors longer than this are never cached, so a thread does not pin
+// several huge reciprocals (remainder trees divide by ever new ones).
+constexpr int CACHE_MAX_LIMBS = 1 << 20;
+constexpr int CACHE_ENTRIES = 4;
+
+// q[0..nu-nv] = u / v, r[0..nv) = u % v; nv >= 2, v[nv-1] != 0, nu >= nv.
+inline void knuth(uint32_t* q, uint32_t* r, const uint32_t* u, int nu, const uint32_t* v, int nv) {
+    int s = __builtin_clz(v[nv - 1]);
+    bigmul::Scratch vs(nv), us(nu + 1);
+    uint32_t *vn = vs.p, *un = us.p;
+    for (int i = nv - 1; i > 0; --i) vn[i] = s ? (v[i] << s) | (v[i - 1] >> (32 - s)) : v[i];
+    vn[0] = v[0] << s;
+    un[nu] = s ? u[nu - 1] >> (32 - s) : 0;
+    for (int i = nu - 1; i > 0; --i) un[i] = s ? (u[i] << s) | (u[i - 1] >> (32 - s)) : u[i];
+    un[0] = u[0] << s;
+
+    uint64_t top = vn[nv - 1], next = vn[nv - 2];
+    for (int j = nu - nv; j >= 0; --j) {
+        INSTRUMENT_COUNT(DIV_STEP);
+        uint64_t num = ((uint64_t)un[j + nv] << 32) | un[j + nv - 1];
+        uint64_t qhat = num / top, rhat = num % top;
+        while (qhat >> 32 || qhat * next > ((rhat << 32) | un[j + nv - 2])) {
+            --qhat; rhat += top;
+            if (rhat >> 32) break;
+        }
+        // un[j..j+nv] -= qhat * vn; one too many if it goes negative
+        uint64_t carry = 0;
+        for (int i = 0; i < nv; ++i) {
+            uint64_t p = qhat * vn[i] + carry;
+            uint32_t lo = (uint32_t)p;
+            carry = (p >> 32) + (un[i + j] < lo);
+            un[i + j] -= lo;
+        }
+        bool under = un[j + nv] < carry;
+        un[j + nv] -= (uint32_t)carry;
+        if (under) { --qhat; bigmul::addTo(un + j, nv + 1, vn, nv); }
+        q[j] = (uint32_t)qhat;
+    }
+    for (int i = 0; i < nv; ++i) r[i] = s ? (un[i] >> s) | (un[i + 1] << (32 - s)) : un[i];
+}
+
+// Limbs [from, from + count) of x, and x shifted up by `words` limbs.
+inline BigInt slice(const BigInt& x, int from, int count = 1 << 30) {
+    int n = std::min(count, x.wordCount() - from);
+    return n > 0 ? BigInt::fromWords(x.words() + from, n) : BigInt(0);
+}
+inline BigInt shifted(BigInt x, int words) { x <<= 32 * words; return x; }
+
+inline void knuthDivMod(const BigInt& a, const BigInt& d, BigInt& q, BigInt& r) {
+    int na = a.wordCount(), nd = d.wordCount();
+    if (a < d || nd == 1) { a.divMod(d, q, r); return; }
+    bigmul::Scratch qs(na - nd + 1), rs(nd);
+    knuth(qs.p, rs.p, a.words(), na, d.words(), nd);
+    q = BigInt::fromWords(qs.p, na - nd + 1);
+    r = BigInt::fromWords(rs.p, nd);
+}
+
+inline void div3n2n(const BigInt& a, const BigInt& b, BigInt& q, BigInt& r);
+
+// a < b * B^n, b exactly n limbs with its top bit set.
+inline void div2n1n(const BigInt& a, const BigInt& b, BigInt& q, BigInt& r) {
+    int n = b.wordCount();
+    if (n % 2 || n < thresholds.bz) { knuthDivMod(a, b, q, r); return; }
+    int h = n / 2;
+    BigInt q1, r1, q2;
+    div3n2n(slice(a, h), b, q1, r1);
+    div3n2n(shifted(std::move(r1), h) + slice(a, 0, h), b, q2, r);
+    q = shifted(std::move(q1), h) + q2;
+}
+
+// a < b * B^h, b exactly 2h limbs with its top bit set: the quotient is
+// estimated from the top halves (a / B^h) / (b / B^h), then corrected by
+// the low half of b, at most twice.
+inline void div3n2n(const BigInt& a, const BigInt& b, BigInt& q, BigInt& r) {
+    int h = b.wordCount() / 2;
+    BigInt b1 = slice(b, h), r1;
+    if (slice(a, 2 * h) < b1) div2n1n(slice(a, h), b1, q, r1);
+    else {
+        std::vector<uint32_t> ones(h, 0xFFFFFFFFu);
+        q = BigInt::fromWords(ones.data(), h);     // B^h - 1
+        r1 = slice(a, h) + b1 - shifted(b1, h);
+    }
+    BigInt p = q * slice(b, 0, h), rh = shifted(std::move(r1), h) + slice(a, 0, h);
+    while (rh < p) { q -= BigInt(1); rh += b; }
+    rh -= p;
+    r = std::move(rh);
+}
+
+// Burnikel-Ziegler on whole numbers: b is padded to m blocks of j limbs
+// (j below the threshold, m a power of two) and shifted so its top bit is
+// set, then a is divided one n-limb block at a time from the top.
+inline void burnikelZiegler(const BigInt& a, const BigInt& b, BigInt& q, BigInt& r) {
+    int s = b.wordCount();
+    int m = 1 << (32 - __builtin_clz((unsigned)std::max(1, s / thresholds.bz)));
+    int n = (s + m - 1) / m * m;
+    int sigma = 32 * n - b.bitLength();
+    BigInt bs = b, as = a;
+    bs <<= sigma; as <<= sigma;
+    int t = std::max(2, (as.bitLength() + 32 * n) / (32 * n));
+    std::vector<uint32_t> qw((size_t)t * n, 0);
+    BigInt z = slice(as, (t - 2) * n), qi, ri;
+    for (int i = t - 2;; --i) {
+        div2n1n(z, bs, qi, ri);
+        memcpy(qw.data() + (size_t)i * n, qi.words(), qi.wordCount() * sizeof(uint32_t));
+        if (i == 0) break;
+        z = shifted(std::move(ri), n) + slice(as, (i - 1) * n, n);
+    }
+    q = BigInt::fromWords(qw.data(), (int)qw.size());
+    ri >>= sigma;
+    r = std::move(ri);
+}
+
+// Knuth or Burnikel-Ziegler, whichever the sizes call for.
+inline void classic(const BigInt& a, const BigInt& d, BigInt& q, BigInt& r) {
+    int nd = d.wordCount(), nq = a.wordCount() - nd + 1;
+    if (nd >= thresholds.bz && nq >= thresholds.bz) burnikelZiegler(a, d, q, r);
+    else knuthDivMod(a, d, q, r);
+}
+
+// B^2n / d for d of exactly n limbs with its top bit set, to within a few
+// units. From the reciprocal x of the top h = n/2 + 2 limbs, one Newton
+// step x += x (B^2n - d x) / B^2n squares the relative error, which the
+// guard limbs keep below one unit. The correction term is itself only
+// about n/2 limbs long, so it is taken from the top k limbs of x and of
+// B^2n - d x.
+inline BigInt reciprocal(const BigInt& d) {
+    int n = d.wordCount();
+    BigInt p; p.setBit(64 * n);
+    if (n < 2 * std::max(thresholds.bz, 8)) {
+        BigInt x, rem;
+        classic(p, d, x, rem);
+        return x;
+    }
+    int h = n / 2 + 2, k = n - h + 4;
+    BigInt x = shifted(reciprocal(slice(d, n - h)), n - h);
+    BigInt dx = d * x;
+    bool low = dx <= p;
+    BigInt e = low ? p - dx : dx - p;
+    int kx = std::max(0, x.wordCount() - k), ke = std::max(0, e.wordCount() - k);
+    BigInt c = slice(slice(x, kx) * slice(e, ke), 2 * n - kx - ke);
+    if (low) x += c;
+    else { x -= c; x -= BigInt(2); }
+    return x;
+}
+
+// A divisor with its reciprocal, for dividing by it many times.
+class Reciprocal {
+public:
+    explicit Reciprocal(const BigInt& divisor) : d(divisor), dn(divisor) {
+        n = d.wordCount();
+        shift = __builtin_clz(d.words()[n - 1]);
+        dn <<= shift;
+        inv = reciprocal(dn);
+    }
+    const BigInt& divisor() const { return d; }
+
+    // Barrett on n-limb slices of a (scaled like dn), top down: each step
+    // divides c = rem * B^n + slice < dn * B^n, estimating
+    // q = ((c / B^(n-1)) * inv) / B^(n+1), within a few of the quotient.
+    void divMod(const BigInt& a, BigInt& q, BigInt& r) const {
+        BigInt as = a;
+        as <<= shift;
+        int blocks = (as.wordCount() + n - 1) / n;
+        std::vector<uint32_t> qw((size_t)blocks * n, 0);
+        BigInt rem;
+        for (int i = blocks - 1; i >= 0; --i) {
+            BigInt c = shifted(std::move(rem), n) + slice(as, i * n, n);
+            BigInt qh = slice(slice(c, n - 1) * inv, n + 1), p = qh * dn;
+            while (c < p) { qh -= BigInt(1); p -= dn; }
+            c -= p;
+            while (c >= dn) { c -= dn; qh += BigInt(1); }
+            memcpy(qw.data() + (size_t)i * n, qh.words(), qh.wordCount() * sizeof(uint32_t));
+            rem = std::move(c);
+        }
+        q = BigInt::fromWords(qw.data(), (int)qw.size());
+        rem >>= shift;
+        r = std::move(rem);
+    }
+
+private:
+    BigInt d, dn, inv;
+    int n, shift;
+};
+
+// Per-thread reciprocals, most recent first, and fingerprints of the
+// divisors seen lately: a reciprocal is built the second time a divisor
+// comes by (or the first, once it pays for itself).
+struct Cache {
+    std::vector<std::unique_ptr<Reciprocal>> entries;
+    uint64_t seen[CACHE_ENTRIES] = {};
+    int nextSeen = 0;
+
+    static uint64_t fingerprint(const BigInt& d) {
+        uint64_t h = 1469598103934665603ull;
+        for (int i = 0; i < d.wordCount(); ++i) h = (h ^ d.words()[i]) * 1099511628211ull;
+        return h | 1;
+    }
+    const Reciprocal* find(const BigInt& d) {
+        for (size_t i = 0; i < entries.size(); ++i)
+            if (entries[i]->divisor() == d) {
+                std::rotate(entries.begin(), entries.begin() + i, entries.begin() + i + 1);
+                return entries[0].get();
+            }
+        return nullptr;
+    }
+    // True the second time d is offered.
+    bool repeated(const BigInt& d) {
+        uint64_t f = fingerprint(d);
+        for (uint64_t s : seen) if (s == f) return true;
+        seen[nextSeen] = f; nextSeen = (nextSeen + 1) % CACHE_ENTRIES;
+        return false;
+    }
+    const Reciprocal* insert(const BigInt& d) {
+        if (entries.size() == (size_t)CACHE_ENTRIES) entries.pop_back();
+        entries.insert(entries.begin(), std::unique_ptr<Reciprocal>(new Reciprocal(d)));
+        return entries[0].get();
+    }
+};
+
+inline Cache& cache() {
+    arena::pool();                                 // the pool must outlive the cache
+    thread_local Cache c;
+    return c;
+}
+
+// q = a / d, r = a % d for d of at least two limbs and a >= d. `top` forces
+// the method (the tuner and self-test use it); Burnikel-Ziegler still ends
+// in Knuth below the threshold.
+inline void divMod(const BigInt& a, const BigInt& d, BigInt& q, BigInt& r, Method top = AUTO) {
+    const Thresholds& th = thresholds;
+    int nd = d.wordCount(), nq = a.wordCount() - nd + 1;
+    switch (top) {
+    case KNUTH: knuthDivMod(a, d, q, r); return;
+    case BURNIKEL_ZIEGLER: burnikelZiegler(a, d, q, r); return;
+    case NEWTON: Reciprocal(d).divMod(a, q, r); return;
+    case AUTO: break;
+    }
+    if (nq < th.bz || nd < std::min(th.cached, th.bz)) { knuthDivMod(a, d, q, r); return; }
+    if (nd >= th.cached && nd <= CACHE_MAX_LIMBS) {
+        Cache& c = cache();
+        const Reciprocal* rec = c.find(d);
+        if (!rec && (c.repeated(d) || nd >= th.newton)) rec = c.insert(d);
+        if (rec) { rec->divMod(a, q, r); return; }
+    } else if (nd >= th.newton) { Reciprocal(d).divMod(a, q, r); return; }
+    classic(a, d, q, r);
+}
+
+} // namespace bigdiv
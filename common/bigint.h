@@ -0,0 +1,597 @@
+// Unsigned big integer shared by the project tools and rsatool: 32-bit
+// limbs, least significant first, any length. Values up to INLINE limbs
+// (256 bits) live in the object itself; longer ones take a block from the
+// per-thread pool in arena.h, and a move hands that block over. Limbs in
+// [size, cap) are always zero. The reducers after the class are the
+// policies powerMod is parameterised on.
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include "arena.h"
+#include "instrument.h"
+#include "hexcodec.h"
+#include "fastio.h"
+
+struct DivReducer;
+
+class BigInt {
+private:
+    static constexpr int INLINE = 8;
+    uint32_t* data;
+    int size = 1;
+    int cap;
+    uint32_t small[INLINE];
+    inline static thread_local uint64_t copyCount = 0;
+
+    // Fresh zeroed storage for at least `words` limbs; the old block, if
+    // any, is the caller's to drop().
+    void allocate(int words) {
+        if (words <= INLINE) { data = small; cap = INLINE; }
+        else data = arena::allocate(words, cap);
+        memset(data, 0, (size_t)cap * sizeof(uint32_t));
+    }
+    void drop() { if (data != small) arena::release(data); }
+    // Grows to hold `words` limbs, keeping the value.
+    void reserve(int words) {
+        if (words <= cap) return;
+        uint32_t* old = data;
+        allocate(words);
+        memcpy(data, old, (size_t)size * sizeof(uint32_t));
+        if (old == small) memset(small, 0, sizeof small);
+        else arena::release(old);
+    }
+    // Zeroed storage for `words` limbs, reusing the block when it is big enough.
+    void clearTo(int words) {
+        if (cap < words) { drop(); allocate(words); }
+        else memset(data, 0, (size_t)size * sizeof(uint32_t));
+    }
+    // Copies o's value into the current storage, growing it if needed.
+    void assign(const BigInt& o) {
+        if (cap < o.size) { drop(); allocate(o.size); }
+        else if (size > o.size) memset(data + o.size, 0, (size_t)(size - o.size) * sizeof(uint32_t));
+        memcpy(data, o.data, (size_t)o.size * sizeof(uint32_t));
+        size = o.size;
+    }
+    // Result under construction with room for `n` limbs, value 0.
+    struct Words { int n; };
+    explicit BigInt(Words w) { INSTRUMENT_COUNT(CONSTRUCT); allocate(std::max(1, w.n)); }
+
+    void normalize() {
+        while (size > 1 && data[size - 1] == 0) size--;
+        if (size == 0) size = 1;
+    }
+public:
+    BigInt() { INSTRUMENT_COUNT(CONSTRUCT); allocate(1); }
+    BigInt(const BigInt& o) : size(o.size) {
+        ++copyCount;
+        INSTRUMENT_COUNT(CONSTRUCT); INSTRUMENT_COUNT(COPY);
+        allocate(o.size);
+        memcpy(data, o.data, (size_t)size * sizeof(uint32_t));
+    }
+    // Steals a pooled block; inline values are copied. The source is left 0.
+    BigInt(BigInt&& o) noexcept : size(o.size) {
+        INSTRUMENT_COUNT(CONSTRUCT);
+        if (o.data == o.small) {
+            data = small; cap = INLINE;
+            memcpy(small, o.small, sizeof small);
+            memset(o.small, 0, sizeof o.small);
+        } else {
+            data = o.data; cap = o.cap;
+            memset(small, 0, sizeof small);
+            o.allocate(1);
+        }
+        o.size = 1;
+    }
+    BigInt& operator=(const BigInt& o) {
+        if (this == &o) return *this;
+        ++copyCount;
+        INSTRUMENT_COUNT(COPY);
+        assign(o);
+        return *this;
+    }
+    BigInt& operator=(BigInt&& o) noexcept {
+        if (this == &o) return *this;
+        if (o.data == o.small) { assign(o); return *this; }  // <= INLINE limbs: a few stores
+        drop();
+        data = o.data; cap = o.cap; size = o.size;
+        memset(small, 0, sizeof small);
+        o.allocate(1); o.size = 1;
+        return *this;
+    }
+    ~BigInt() { drop(); }
+    // Deep copies (copy construction or assignment) made on this thread.
+    static uint64_t copies() { return copyCount; }
+
+    // Three moves: O(1) for pooled storage, a few stores for inline values.
+    void swap(BigInt& o) noexcept {
+        BigInt t(std::move(o));
+        o = std::move(*this);
+        *this = std::move(t);
+    }
+    friend void swap(BigInt& a, BigInt& b) noexcept { a.swap(b); }
+
+    BigInt(uint64_t v) {
+        INSTRUMENT_COUNT(CONSTRUCT);
+        allocate(2);
+        data[0] = (uint32_t)(v & 0xFFFFFFFFu);
+        if (v > 0xFFFFFFFFu) {
+            data[1] = (uint32_t)(v >> 32);
+            size = 2;
+        }
+        normalize();
+    }
+
+    BigInt(const std::string& hex) : BigInt(hex.data(), hex.size()) {}
+    BigInt(const char* hex, size_t len) : BigInt() { assignHex(hex, len); }
+    void assignHex(const char* hex, size_t len) {
+        int need = (int)(len / 8 + 1);
+        clearTo(need);
+        size = hexcodec::decode(hex, len, data, need); normalize();
+    }
+    void assignWords(const uint32_t* w, int n) {
+        int need = std::max(1, n);
+        clearTo(need);
+        size = need;
+        if (n > 0) memcpy(data, w, size * sizeof(uint32_t));
+        normalize();
+    }
+    const uint32_t* words() const { return data; }
+    int wordCount() const { return size; }
+
+
+    bool isZero() const { return size == 1 && data[0] == 0; }
+    bool isOne()  const { return size == 1 && data[0] == 1; }
+    bool isEven() const { return (data[0] & 1u) == 0; }
+
+    int bitLength() const {
+        if (isZero()) return 0;
+        int len = (size - 1) * 32; uint32_t top = data[size - 1];
+        while (top) { ++len; top >>= 1; } return len;
+    }
+    bool getBit(int pos) const {
+        int w = pos / 32, b = pos % 32; if (w >= size) return false;
+        return (data[w] >> b) & 1u;
+    }
+    void setBit(int pos) {
+        int w = pos / 32, b = pos % 32;
+        reserve(w + 1); data[w] |= (1u << b); if (w >= size) size = w + 1;
+    }
+
+    bool operator<(const BigInt& o) const {
+        if (size != o.size) return size < o.size;
+        for (int i = size - 1; i >= 0; --i) if (data[i] != o.data[i]) return data[i] < o.data[i];
+        return false;
+    }
+    bool operator> (const BigInt& o) const { return o < *this; }
+    bool operator<=(const BigInt& o) const { return !(o < *this); }
+    bool operator>=(const BigInt& o) const { return !(*this < o); }
+    bool operator==(const BigInt& o) const {
+        if (size != o.size) return false;
+        for (int i = 0; i < size; ++i) if (data[i] != o.data[i]) return false;
+        return true;
+    }
+
+    BigInt operator+(const BigInt& o) const {
+        int m = std::max(size, o.size);
+        BigInt r(Words{m + 1}); uint64_t carry = 0;
+        for (int i = 0; i < m || carry; ++i) {
+            uint64_t s = carry;
+            if (i < size) s += data[i];
+            if (i < o.size) s += o.data[i];
+            r.data[i] = (uint32_t)(s & 0xFFFFFFFFu);
+            carry = s >> 32; r.size = i + 1;
+        }
+        r.normalize(); return r;
+    }
+    BigInt operator-(const BigInt& o) const {
+        if (*this < o) return BigInt(0);
+        BigInt r(Words{size}); int64_t borrow = 0;
+        for (int i = 0; i < size; ++i) {
+            int64_t d = (int64_t)data[i] - borrow - (i < o.size ? o.data[i] : 0);
+            if (d < 0) { d += (1LL<<32); borrow = 1; } else borrow = 0;
+            r.data[i] = (uint32_t)d; r.size = i + 1;
+        }
+        r.normalize(); return r;
+    }
+    BigInt shiftLeft(int n) const {
+        if (n == 0 || isZero()) return *this;
+        int ws = n/32, bs = n%32;
+        BigInt r(Words{size + ws + (bs?1:0)}); r.size = size + ws + (bs?1:0);
+        if (bs == 0) for (int i=0;i<size;++i) r.data[i+ws]=data[i];
+        else{
+            uint64_t carry=0;
+            for (int i=0;i<size;++i){
+                uint64_t t= ((uint64_t)data[i] << bs)|carry;
+                r.data[i+ws]=(uint32_t)(t & 0xFFFFFFFFu); carry = t >> 32;
+            }
+            if (carry) r.data[ws+size]=(uint32_t)carry;
+        }
+        r.normalize(); return r;
+    }
+    BigInt shiftRight(int n) const {
+        if (n == 0 || isZero()) return *this;
+        int ws = n/32, bs = n%32; if (ws >= size) return BigInt(0);
+        BigInt r(Words{size - ws});
+        for (int i=ws;i<size;++i) r.data[i-ws]=data[i];
+        if (bs){
+            for (int i=0;i<size-ws;++i){
+                r.data[i] >>= bs;
+                if (i+1 < size-ws) r.data[i] |= (r.data[i+1] & ((1u<<bs)-1)) << (32-bs);
+            }
+        }
+        r.size = size - ws; r.normalize(); return r;
+    }
+    // In-place forms of +, -, shiftLeft and shiftRight (same results, a - b
+    // clamps to 0 likewise): they work in this value's storage instead of
+    // building a new one.
+    BigInt& operator+=(const BigInt& o) {
+        reserve(std::max(size, o.size) + 1);
+        uint64_t carry = 0; int i = 0;
+        for (; i < o.size || carry; ++i) {
+            uint64_t s = carry + data[i] + (i < o.size ? o.data[i] : 0);
+            data[i] = (uint32_t)s; carry = s >> 32;
+        }
+        size = std::max(size, i); normalize(); return *this;
+    }
+    BigInt& operator-=(const BigInt& o) {
+        if (*this < o) { clearTo(1); size = 1; return *this; }
+        int64_t borrow = 0;
+        for (int i = 0; i < size && (i < o.size || borrow); ++i) {
+            int64_t d = (int64_t)data[i] - borrow - (i < o.size ? o.data[i] : 0);
+            if (d < 0) { d += (1LL<<32); borrow = 1; } else borrow = 0;
+            data[i] = (uint32_t)d;
+        }
+        normalize(); return *this;
+    }
+    BigInt& operator<<=(int n) {
+        if (n == 0 || isZero()) return *this;
+        int ws = n/32, bs = n%32, m = size + ws + 1;
+        reserve(m);
+        for (int i = m - 1; i >= ws; --i) {
+            int j = i - ws;
+            uint32_t hi = j < size ? data[j] : 0, lo = j > 0 && j - 1 < size ? data[j - 1] : 0;
+            data[i] = bs ? (hi << bs) | (lo >> (32 - bs)) : hi;
+        }
+        memset(data, 0, (size_t)ws * sizeof(uint32_t));
+        size = m; normalize(); return *this;
+    }
+    BigInt& operator>>=(int n) {
+        int ws = n/32, bs = n%32;
+        if (ws >= size) { clearTo(1); size = 1; return *this; }
+        int m = size - ws;
+        for (int i = 0; i < m; ++i) {
+            uint32_t lo = data[i + ws], hi = i + ws + 1 < size ? data[i + ws + 1] : 0;
+            data[i] = bs ? (lo >> bs) | (hi << (32 - bs)) : lo;
+        }
+        memset(data + m, 0, (size_t)ws * sizeof(uint32_t));
+        size = m; normalize(); return *this;
+    }
+    // r[0..n) += a[0..n) * m, returns the carry word that belongs at r[n].
+    // operator*, square() and the Barrett/Montgomery reductions all go through
+    // here; the kernel is picked once, at first use.
+    typedef uint32_t (*RowFn)(uint32_t*, const uint32_t*, int, uint32_t);
+    static uint32_t mulAddRow(uint32_t* r, const uint32_t* a, int n, uint32_t m) {
+        static const RowFn row = pickRowKernel();
+        return row(r, a, n, m);
+    }
+    static uint32_t mulAddRowPortable(uint32_t* r, const uint32_t* a, int n, uint32_t m) {
+        uint64_t carry = 0;
+        for (int j = 0; j < n; ++j) {
+            uint64_t sum = (uint64_t)a[j] * m + r[j] + carry;
+            r[j] = (uint32_t)sum; carry = sum >> 32;
+        }
+        return (uint32_t)carry;
+    }
+#ifdef __x86_64__
+    // Same row with BMI2 mulx and two independent carry chains: adcx (CF)
+    // adds r[j] to the low half, adox (OF) adds the previous high half.
+    // Only lea/mov/jrcxz sit between them, so neither chain is clobbered.
+    // Four limbs per pass; the tail continues in portable code.
+    __attribute__((target("bmi2,adx")))
+    static uint32_t mulAddRowAdx(uint32_t* r, const uint32_t* a, int n, uint32_t m) {
+        uint64_t blocks = (uint64_t)(n / 4);
+        uint32_t hi = 0;
+        if (blocks) {
+            uint32_t* rp = r; const uint32_t* ap = a;
+            asm volatile(
+                "xorl %[hi], %[hi]\n\t"
+                "1:\n\t"
+                "mulxl (%[ap]), %%eax, %%r9d\n\t"
+                "adcxl (%[rp]), %%eax\n\t"
+                "adoxl %[hi], %%eax\n\t"
+                "movl %%eax, (%[rp])\n\t"
+                "mulxl 4(%[ap]), %%eax, %[hi]\n\t"
+                "adcxl 4(%[rp]), %%eax\n\t"
+                "adoxl %%r9d, %%eax\n\t"
+                "movl %%eax, 4(%[rp])\n\t"
+                "mulxl 8(%[ap]), %%eax, %%r9d\n\t"
+                "adcxl 8(%[rp]), %%eax\n\t"
+                "adoxl %[hi], %%eax\n\t"
+                "movl %%eax, 8(%[rp])\n\t"
+                "mulxl 12(%[ap]), %%eax, %[hi]\n\t"
+                "adcxl 12(%[rp]), %%eax\n\t"
+                "adoxl %%r9d, %%eax\n\t"
+                "movl %%eax, 12(%[rp])\n\t"
+                "leaq 16(%[ap]), %[ap]\n\t"
+                "leaq 16(%[rp]), %[rp]\n\t"
+                "leaq -1(%%rcx), %%rcx\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n\t"
+                "2:\n\t"
+                "movl $0, %%eax\n\t"
+                "adcxl %%eax, %[hi]\n\t"
+                "adoxl %%eax, %[hi]\n\t"
+                : [hi] "=&r"(hi), [rp] "+r"(rp), [ap] "+r"(ap), "+c"(blocks)
+                : "d"(m)
+                : "rax", "r9", "cc", "memory");
+        }
+        uint64_t carry = hi;
+        for (int j = n & ~3; j < n; ++j) {
+            uint64_t sum = (uint64_t)a[j] * m + r[j] + carry;
+            r[j] = (uint32_t)sum; carry = sum >> 32;
+        }
+        return (uint32_t)carry;
+    }
+#endif
+    static RowFn pickRowKernel() {
+#ifdef __x86_64__
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx")) return mulAddRowAdx;
+#endif
+        return mulAddRowPortable;
+    }
+    static BigInt fromWords(const uint32_t* w, int n) {
+        BigInt r(Words{n});
+        if (n > 0) memcpy(r.data, w, n * sizeof(uint32_t));
+        r.size = std::max(n, 1); r.normalize(); return r;
+    }
+
+    // Schoolbook r[0..na+nb) = a*b and r[0..2n) = a^2, the base tier of
+    // bigmul.h; r must not overlap the inputs.
+    static void mulWords(uint32_t* r, const uint32_t* a, int na, const uint32_t* b, int nb) {
+        memset(r, 0, (size_t)(na + nb) * sizeof(uint32_t));
+        for (int i = 0; i < na; ++i)
+            r[i + nb] = mulAddRow(r + i, b, nb, a[i]);
+    }
+    // Each cross product a[i]*a[j], i < j, is computed once, the sum is
+    // doubled and the diagonal a[i]^2 added on top.
+    static void sqrWords(uint32_t* r, const uint32_t* a, int n) {
+        memset(r, 0, (size_t)(2 * n) * sizeof(uint32_t));
+        for (int i = 0; i + 1 < n; ++i)
+            r[i + n] = mulAddRow(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+        uint32_t top = 0;
+        for (int i = 0; i < 2 * n; ++i) {
+            uint32_t w = r[i];
+            r[i] = (w << 1) | top; top = w >> 31;
+        }
+        uint64_t carry = 0;
+        for (int i = 0; i < n; ++i) {
+            uint64_t sq = (uint64_t)a[i] * a[i];
+            uint64_t lo = (uint64_t)r[2 * i] + (uint32_t)sq + carry;
+            r[2 * i] = (uint32_t)lo;
+            uint64_t hi = (uint64_t)r[2 * i + 1] + (sq >> 32) + (lo >> 32);
+            r[2 * i + 1] = (uint32_t)hi; carry = hi >> 32;
+        }
+    }
+    // Both go through the size tiers of bigmul.h (defined after the class).
+    BigInt operator*(const BigInt& o) const;
+    BigInt square() const;
+    // Single-limb divisors here; longer ones go through the tiers of
+    // bigdiv.h (defined after the class).
+    void divMod(const BigInt& d, BigInt& q, BigInt& r) const;
+    BigInt operator/(const BigInt& o) const { BigInt q,r; divMod(o,q,r); return q; }
+    BigInt operator%(const BigInt& o) const { BigInt q,r; divMod(o,q,r); return r; }
+
+    static BigInt mulMod(const BigInt& a, const BigInt& b, const BigInt& n) {
+        if (n.isOne()) return BigInt(0);
+        BigInt prod = a * b;
+        return prod % n;
+    }
+    int popCount() const {
+        int c = 0;
+        for (int i = 0; i < size; ++i) c += __builtin_popcount(data[i]);
+        return c;
+    }
+
+    // Public exponents (3, 17, 65537, ...) are short or have very few set bits.
+    static bool isShortExponent(const BigInt& exp) {
+        return exp.bitLength() <= 32 || exp.popCount() <= 4;
+    }
+    // Left-to-right square-and-multiply: bitLength-1 squarings and popCount-1
+    // multiplies, i.e. 16 squarings + 1 multiply for e = 65537.
+    template <class Reducer>
+    static BigInt powerModShort(const Reducer& red, const BigInt& base, const BigInt& exp) {
+        if (exp.isZero()) return red.from(red.one());
+        BigInt b = red.to(base), result = b;
+        for (int i = exp.bitLength() - 2; i >= 0; --i) {
+            result = red.sqr(result);
+            if (exp.getBit(i)) result = red.mul(result, b);
+        }
+        return red.from(std::move(result));
+    }
+    template <class Reducer>
+    static BigInt powerModGeneric(const Reducer& red, const BigInt& base, const BigInt& exp) {
+        BigInt result = red.one(), b = red.to(base);
+        int bits = exp.bitLength();
+        for (int i = 0; i < bits; ++i) {
+            if (exp.getBit(i)) result = red.mul(result, b);
+            if (i + 1 < bits) b = red.sqr(b);
+        }
+        return red.from(std::move(result));
+    }
+    // Reducer picks how products are brought back below n: DivReducer (plain
+    // operator%), BarrettReducer or MontgomeryReducer. Moduli a reducer cannot
+    // handle fall back to DivReducer.
+    template <class Reducer = DivReducer>
+    static BigInt powerMod(const BigInt& base, const BigInt& exp, const BigInt& n) {
+        if (n.isOne() || n.isZero()) return BigInt(0);   // no residues mod 0: report 0
+        arena::Scope scope;
+        if (!Reducer::supports(n)) return powerMod<DivReducer>(base, exp, n);
+        Reducer red(n);
+        return isShortExponent(exp) ? powerModShort(red, base, exp)
+                                    : powerModGeneric(red, base, exp);
+    }
+
+    friend struct DivReducer;
+    friend struct BarrettReducer;
+    friend struct MontgomeryReducer;
+    friend struct LaneModExp;
+    friend struct Ifma52Montgomery;
+    friend std::istream& operator>>(std::istream& is, BigInt& n);
+    friend std::ostream& operator<<(std::ostream& os, const BigInt& n);
+    friend fastio::BufferedOutput& operator<<(fastio::BufferedOutput& out, const BigInt& n);
+};
+
+#include "bigmul.h"
+
+inline BigInt BigInt::operator*(const BigInt& o) const {
+    INSTRUMENT_COUNT(MUL);
+    BigInt r(Words{size + o.size}); r.size = size + o.size;
+    bigmul::mul(r.data, data, size, o.data, o.size);
+    r.normalize(); return r;
+}
+inline BigInt BigInt::square() const {
+    INSTRUMENT_COUNT(SQR);
+    BigInt r(Words{2 * size}); r.size = 2 * size;
+    bigmul::sqr(r.data, data, size);
+    r.normalize(); return r;
+}
+
+#include "bigdiv.h"
+
+inline void BigInt::divMod(const BigInt& d, BigInt& q, BigInt& r) const {
+    if (d.isZero()) { q = BigInt(0); r = BigInt(0); return; }
+    if (*this < d) { q = BigInt(0); r = *this; return; }
+    if (d.size == 1) {
+        uint64_t div = d.data[0], rem = 0;
+        BigInt quot(Words{size}); quot.size = size;
+        for (int i = size - 1; i >= 0; --i) {
+            INSTRUMENT_COUNT(DIV_STEP);
+            rem = (rem << 32) | data[i];
+            quot.data[i] = (uint32_t)(rem / div);
+            rem %= div;
+        }
+        quot.normalize();
+        q = std::move(quot); r = BigInt((uint64_t)rem);
+        return;
+    }
+    bigdiv::divMod(*this, d, q, r);
+}
+
+// Every reducer works on values in its own domain: to() maps x mod n in,
+// from() maps back out, one() is 1 in the domain, mul() multiplies and
+// sqr() squares.
+struct DivReducer {
+    BigInt n;
+    static bool supports(const BigInt& m) { return !m.isZero(); }
+    explicit DivReducer(const BigInt& m) : n(m) {}
+    BigInt to(const BigInt& x) const { return x < n ? x : x % n; }
+    BigInt from(BigInt x) const { return x; }
+    BigInt one() const { return BigInt(1); }
+    BigInt mul(const BigInt& a, const BigInt& b) const { INSTRUMENT_COUNT(REDUCE); return BigInt::mulMod(a, b, n); }
+    BigInt sqr(const BigInt& a) const { INSTRUMENT_COUNT(REDUCE); return a.square() % n; }
+};
+
+// Barrett: mu = floor((b^2k - 1) / n) with b = 2^32, k = n.size, computed once
+// per modulus; each reduction is then two truncated products and at most a
+// few subtractions. (b^2k - 1 differs from b^2k only when n is a power of two,
+// which the final correction loop absorbs.)
+struct BarrettReducer {
+    BigInt n, mu; int k;
+    static bool supports(const BigInt& m) { return !m.isZero(); }
+    explicit BarrettReducer(const BigInt& m) : n(m), k(m.size) {
+        BigInt top(BigInt::Words{2 * k}); top.size = 2 * k;
+        for (int i = 0; i < 2 * k; ++i) top.data[i] = 0xFFFFFFFFu;
+        mu = top / n;
+    }
+    // x < n^2; taken by value so a product passed in is reused, not copied
+    BigInt reduce(BigInt x) const {
+        INSTRUMENT_COUNT(REDUCE);
+        if (x < n) return x;
+        const uint32_t* q1 = x.data + (k - 1);
+        int q1n = x.size - (k - 1);
+        BigInt Q2(BigInt::Words{q1n + mu.size + 1}), R2(BigInt::Words{k + 1}), res(BigInt::Words{k + 1});
+        uint32_t *q2 = Q2.data, *r2 = R2.data, *r = res.data;
+        for (int i = 0; i < q1n; ++i)
+            q2[i + mu.size] = BigInt::mulAddRow(q2 + i, mu.data, mu.size, q1[i]);
+        const uint32_t* q3 = q2 + (k + 1);
+        int q3n = q1n + mu.size - (k + 1);
+        // r2 = q3 * n mod b^(k+1)
+        for (int i = 0; i < q3n && i <= k; ++i) {
+            int len = std::min(n.size, k + 1 - i);
+            uint32_t c = BigInt::mulAddRow(r2 + i, n.data, len, q3[i]);
+            if (i + len <= k) r2[i + len] += c;
+        }
+        // r = (x mod b^(k+1)) - r2, wrapping mod b^(k+1)
+        int64_t borrow = 0;
+        for (int i = 0; i <= k; ++i) {
+            int64_t d = (int64_t)(i < x.size ? x.data[i] : 0) - r2[i] - borrow;
+            borrow = d < 0; r[i] = (uint32_t)d;
+        }
+        res.size = k + 1; res.normalize();
+        while (res >= n) res = res - n;
+        return res;
+    }
+    BigInt to(const BigInt& x) const { return x < n ? x : x % n; }
+    BigInt from(BigInt x) const { return x; }
+    BigInt one() const { return n.isOne() ? BigInt(0) : BigInt(1); }
+    BigInt mul(const BigInt& a, const BigInt& b) const { return reduce(a * b); }
+    BigInt sqr(const BigInt& a) const { return reduce(a.square()); }
+};
+
+// Montgomery (odd n only): values are kept as x*R mod n with R = b^k, and
+// each product is reduced word by word with REDC instead of a division.
+struct MontgomeryReducer {
+    BigInt n, rModN, r2; int k; uint32_t nInv;
+    static bool supports(const BigInt& m) { return !m.isEven(); }
+    explicit MontgomeryReducer(const BigInt& m) : n(m), k(m.size) {
+        uint32_t inv = n.data[0];                      // n*inv == 1 mod 2^3
+        for (int i = 0; i < 4; ++i) inv *= 2 - n.data[0] * inv;
+        nInv = 0u - inv;                               // -n^-1 mod 2^32
+        BigInt R; R.setBit(32 * k);
+        rModN = R % n;
+        r2 = (rModN * rModN) % n;
+    }
+    BigInt redc(const BigInt& x) const {
+        INSTRUMENT_COUNT(REDUCE);
+        BigInt T(BigInt::Words{std::max(x.size, 2 * k) + 2});
+        uint32_t* t = T.data;
+        memcpy(t, x.data, x.size * sizeof(uint32_t));
+        for (int i = 0; i < k; ++i) {
+            uint32_t u = t[i] * nInv;
+            uint64_t c = BigInt::mulAddRow(t + i, n.data, k, u);
+            for (int j = i + k; c; ++j) {
+                c += t[j]; t[j] = (uint32_t)c; c >>= 32;
+            }
+        }
+        BigInt res = BigInt::fromWords(t + k, k + 1);
+        if (res >= n) res = res - n;
+        return res;
+    }
+    BigInt to(const BigInt& x) const { return mul(x < n ? x : x % n, r2); }
+    BigInt from(const BigInt& x) const { return redc(x); }
+    BigInt one() const { return rModN; }
+    BigInt mul(const BigInt& a, const BigInt& b) const { return redc(a * b); }
+    BigInt sqr(const BigInt& a) const { return redc(a.square()); }
+};
+
+inline std::istream& operator>>(std::istream& is, BigInt& n) {
+    std::string s; is >> s; n = BigInt(s); return is;
+}
+inline std::ostream& operator<<(std::ostream& os, const BigInt& n) {
+    std::string buf(8 * (size_t)n.size, '\0');
+    os.write(&buf[0], (std::streamsize)hexcodec::encode(n.data, n.size, &buf[0]));
+    return os;
+}
+inline fastio::BufferedOutput& operator<<(fastio::BufferedOutput& out, const BigInt& n) {
+    size_t len = 8 * (size_t)n.size;
+    if (len <= fastio::BufferedOutput::BLOCK) out.commit(hexcodec::encode(n.data, n.size, out.reserve(len)));
+    else {
+        std::string buf(len, '\0');
+        out.write(buf.data(), hexcodec::encode(n.data, n.size, &buf[0]));
+    }
+    return out;
+}
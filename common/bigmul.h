@@ -0,0 +1,294 @@
+// Size-tiered multiplication on little-endian 32-bit limb arrays, behind
+// BigInt::operator* and square():
+//
+//   schoolbook   BigInt::mulWords / sqrWords (row kernel, ADX when present)
+//   Karatsuba    3 half-size products, scratch from the limb pool
+//   Toom-3       5 third-size products at 0, 1, -1, -2, inf (Bodrato's
+//                interpolation sequence)
+//   NTT          three-prime number-theoretic transform over word-size
+//                primes p = c * 2^k + 1, recombined by CRT (Garner)
+//
+// Tiers switch on the shorter operand's limb count. Operands more than twice
+// as long as the other one are cut into slices of the shorter length first.
+// The default thresholds come from `bench --tune` on an AVX-512/ADX core;
+// `thresholds` can be reassigned (the tuner does).
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "arena.h"
+#include "bigint.h"
+
+namespace bigmul {
+
+struct Thresholds {
+    int karatsuba = 48;                            // limbs of the shorter operand
+    int toom3 = 800;
+    int ntt = 5500;
+};
+inline Thresholds thresholds;
+
+enum Tier { AUTO, SCHOOLBOOK, KARATSUBA, TOOM3, NTT };
+
+// Limb scratch from the per-thread pool.
+struct Scratch {
+    uint32_t* p;
+    explicit Scratch(int words) { int cap; p = arena::allocate(std::max(words, 1), cap); }
+    ~Scratch() { arena::release(p); }
+    Scratch(const Scratch&) = delete;
+    Scratch& operator=(const Scratch&) = delete;
+};
+
+// r[0..rn) += x[0..xn), xn <= rn; returns the carry out of r[rn - 1].
+inline uint32_t addTo(uint32_t* r, int rn, const uint32_t* x, int xn) {
+    uint64_t c = 0;
+    int i = 0;
+    for (; i < xn; ++i) { c += (uint64_t)r[i] + x[i]; r[i] = (uint32_t)c; c >>= 32; }
+    for (; c && i < rn; ++i) { c += r[i]; r[i] = (uint32_t)c; c >>= 32; }
+    return (uint32_t)c;
+}
+
+// r[0..rn) -= x[0..xn), xn <= rn, r >= x.
+inline void subFrom(uint32_t* r, int rn, const uint32_t* x, int xn) {
+    int64_t b = 0;
+    int i = 0;
+    for (; i < xn; ++i) {
+        int64_t d = (int64_t)r[i] - x[i] - b;
+        b = d < 0; r[i] = (uint32_t)d;
+    }
+    for (; b && i < rn; ++i) { b = r[i] == 0; --r[i]; }
+}
+
+inline void mul(uint32_t* r, const uint32_t* a, int na, const uint32_t* b, int nb, Tier top = AUTO);
+
+// One Karatsuba level, na / 2 < nb <= na, with h = ceil(na / 2):
+// (a1 X + a0)(b1 X + b0) = z2 X^2 + ((a0 + a1)(b0 + b1) - z0 - z2) X + z0.
+inline void karatsuba(uint32_t* r, const uint32_t* a, int na, const uint32_t* b, int nb) {
+    bool sq = a == b && na == nb;
+    int h = (na + 1) / 2, a1n = na - h, b1n = nb - h;
+    mul(r, a, h, b, h);
+    if (b1n > 0) mul(r + 2 * h, a + h, a1n, b + h, b1n);
+    else memset(r + 2 * h, 0, (size_t)(na + nb - 2 * h) * sizeof(uint32_t));
+    Scratch s(4 * h + 4);
+    uint32_t *sa = s.p, *sb = sq ? sa : s.p + h + 1, *m = s.p + 2 * h + 2;
+    memcpy(sa, a, h * sizeof(uint32_t)); sa[h] = 0;
+    addTo(sa, h + 1, a + h, a1n);
+    if (!sq) {
+        memcpy(sb, b, h * sizeof(uint32_t)); sb[h] = 0;
+        if (b1n > 0) addTo(sb, h + 1, b + h, b1n);
+    }
+    mul(m, sa, h + 1, sb, h + 1);
+    subFrom(m, 2 * h + 2, r, 2 * h);
+    if (b1n > 0) subFrom(m, 2 * h + 2, r + 2 * h, a1n + b1n);
+    int top = 2 * h + 2;
+    while (top > 0 && m[top - 1] == 0) --top;
+    addTo(r + h, na + nb - h, m, std::min(top, na + nb - h));
+}
+
+// Sign-magnitude values for the Toom-3 evaluation and interpolation.
+struct Signed {
+    BigInt m;
+    bool neg = false;
+};
+inline Signed operator+(const Signed& x, const Signed& y) {
+    Signed r;
+    if (x.neg == y.neg) { r.m = x.m + y.m; r.neg = x.neg; }
+    else if (x.m >= y.m) { r.m = x.m - y.m; r.neg = x.neg; }
+    else { r.m = y.m - x.m; r.neg = y.neg; }
+    if (r.m.isZero()) r.neg = false;
+    return r;
+}
+inline Signed operator-(Signed x) { x.neg = !x.neg && !x.m.isZero(); return x; }
+inline Signed operator-(const Signed& x, const Signed& y) { return x + -y; }
+
+// One Toom-3 level, k = ceil(na / 3), nb > k. The pieces and the five point
+// products are BigInts, so each product recurses through operator*.
+inline void toom3(uint32_t* r, const uint32_t* a, int na, const uint32_t* b, int nb) {
+    bool sq = a == b && na == nb;
+    int k = (na + 2) / 3;
+    auto piece = [k](const uint32_t* x, int n, int i) {
+        int len = std::min(k, n - i * k);
+        return Signed{len > 0 ? BigInt::fromWords(x + i * k, len) : BigInt(0)};
+    };
+    auto eval = [](const Signed& x0, const Signed& x1, const Signed& x2, Signed* v) {
+        Signed p = x0 + x2;
+        v[0] = p + x1;                                   // x(1)
+        v[1] = p - x1;                                   // x(-1)
+        Signed t = v[1] + x2;
+        t.m <<= 1;
+        v[2] = t - x0;                                   // x(-2) = 2 (x(-1) + x2) - x0
+    };
+    Signed a0 = piece(a, na, 0), a1 = piece(a, na, 1), a2 = piece(a, na, 2), ea[3], eb[3];
+    eval(a0, a1, a2, ea);
+    Signed b0, b2;
+    if (!sq) { b0 = piece(b, nb, 0); b2 = piece(b, nb, 2); eval(b0, piece(b, nb, 1), b2, eb); }
+    auto prod = [sq](const Signed& x, const Signed& y) {
+        return Signed{sq ? x.m.square() : x.m * y.m, sq ? false : x.neg != y.neg && !x.m.isZero() && !y.m.isZero()};
+    };
+    Signed v0 = prod(a0, b0), v1 = prod(ea[0], eb[0]), vm1 = prod(ea[1], eb[1]),
+           vm2 = prod(ea[2], eb[2]), vinf = prod(a2, b2);
+    const BigInt three(3);
+    Signed r3 = vm2 - v1;  r3.m = r3.m / three;
+    Signed r1 = v1 - vm1;  r1.m >>= 1;
+    Signed r2 = vm1 - v0;
+    r3 = r2 - r3;          r3.m >>= 1;
+    Signed twoInf = vinf;  twoInf.m <<= 1;
+    r3 = r3 + twoInf;
+    r2 = r2 + r1 - vinf;
+    r1 = r1 - r3;
+    int rn = na + nb;
+    memset(r, 0, (size_t)rn * sizeof(uint32_t));
+    const Signed* coef[5] = {&v0, &r1, &r2, &r3, &vinf};
+    for (int i = 0; i < 5; ++i) {
+        const BigInt& c = coef[i]->m;
+        if (c.isZero() || i * k >= rn) continue;
+        addTo(r + i * k, rn - i * k, c.words(), std::min(c.wordCount(), rn - i * k));
+    }
+}
+
+// Transform over Z/P, P = c * 2^k + 1 < 2^31 with primitive root G. The
+// butterflies work on Montgomery residues (x * 2^32 mod P), so a product
+// costs two multiplies and no division, and with P < 2^31 a sum fits a limb:
+// the reductions are branch-free mins the compiler can vectorize.
+template <uint32_t P, uint32_t G>
+struct Ntt {
+    static constexpr uint32_t inverse32() {
+        uint32_t x = P;                                // P * x == 1 mod 2^3
+        for (int i = 0; i < 4; ++i) x *= 2 - P * x;
+        return x;
+    }
+    static constexpr uint32_t PINV = inverse32();
+    static constexpr uint32_t R2 = (uint32_t)(((unsigned __int128)1 << 64) % P);
+
+    // t * 2^-32 mod P for t < P^2: the low halves of t and m P cancel.
+    static uint32_t redc(uint64_t t) {
+        uint32_t m = (uint32_t)t * PINV;
+        uint32_t d = (uint32_t)(t >> 32) - (uint32_t)(((uint64_t)m * P) >> 32);
+        return std::min(d, d + P);
+    }
+    static uint32_t mont(uint32_t a, uint32_t b) { return redc((uint64_t)a * b); }
+    static uint32_t toMont(uint32_t x) { return mont(x % P, R2); }
+    static uint32_t pow(uint32_t b, uint64_t e) {     // plain residues, setup only
+        uint64_t r = 1;
+        for (uint64_t x = b % P; e; e >>= 1, x = x * x % P) if (e & 1) r = r * x % P;
+        return (uint32_t)r;
+    }
+    // In place on Montgomery residues, length n = 2^logn. The inverse leaves
+    // n * x, the caller folds 1/n into its last multiply.
+    static void transform(std::vector<uint32_t>& x, int logn, bool inverse) {
+        size_t n = (size_t)1 << logn;
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j |= bit;
+            if (i < j) std::swap(x[i], x[j]);
+        }
+        // tw[half + j] = w_len^j for the stage of butterflies `half` apart
+        std::vector<uint32_t> tw(n);
+        uint32_t root = pow(G, (P - 1) >> logn);
+        if (inverse) root = pow(root, P - 2);
+        for (size_t half = n / 2; half >= 1; half /= 2) {
+            uint32_t w = toMont(pow(root, n / (2 * half)));
+            tw[half] = toMont(1);
+            for (size_t j = 1; j < half; ++j) tw[half + j] = mont(tw[half + j - 1], w);
+        }
+        for (size_t half = 1; half < n; half *= 2) {
+            const uint32_t* w = &tw[half];
+            for (size_t i = 0; i < n; i += 2 * half)
+                for (size_t j = 0; j < half; ++j) {
+                    uint32_t u = x[i + j], v = mont(x[i + j + half], w[j]);
+                    uint32_t s = u + v, d = u - v;
+                    x[i + j] = std::min(s, s - P);
+                    x[i + j + half] = std::min(d, d + P);
+                }
+        }
+    }
+    // Cyclic convolution of a and b (zero-padded to 2^logn) mod P, as plain
+    // residues.
+    static std::vector<uint32_t> convolve(const uint32_t* a, int na, const uint32_t* b, int nb, int logn) {
+        std::vector<uint32_t> fa((size_t)1 << logn, 0), fb;
+        for (int i = 0; i < na; ++i) fa[i] = toMont(a[i]);
+        transform(fa, logn, false);
+        if (a == b && na == nb) fb = fa;
+        else {
+            fb.assign(fa.size(), 0);
+            for (int i = 0; i < nb; ++i) fb[i] = toMont(b[i]);
+            transform(fb, logn, false);
+        }
+        for (size_t i = 0; i < fa.size(); ++i) fa[i] = mont(fa[i], fb[i]);
+        transform(fa, logn, true);
+        // n c R * n^-1 * R^-1 = c
+        uint32_t invN = pow((uint32_t)(fa.size() % P), P - 2);
+        for (auto& v : fa) v = mont(v, invN);
+        return fa;
+    }
+};
+
+typedef Ntt<2013265921u, 31> Ntt1;                 // 15 * 2^27 + 1
+typedef Ntt<2130706433u, 3> Ntt2;                  // 127 * 2^24 + 1
+typedef Ntt<469762049u, 3> Ntt3;                   // 7 * 2^26 + 1
+constexpr int NTT_MAX_LOG = 24;                    // 2^24 | p - 1 for all three
+
+// Each convolution coefficient is below min(na, nb) * 2^64 <= 2^87, under
+// p1 p2 p3 ~ 2^90.7, so the three residues pin it down exactly.
+inline bool nttFits(int na, int nb) { return (int64_t)na + nb <= ((int64_t)1 << NTT_MAX_LOG); }
+
+inline void ntt(uint32_t* r, const uint32_t* a, int na, const uint32_t* b, int nb) {
+    int logn = 0;
+    while (((int64_t)1 << logn) < (int64_t)na + nb - 1) ++logn;
+    std::vector<uint32_t> c1 = Ntt1::convolve(a, na, b, nb, logn), c2 = Ntt2::convolve(a, na, b, nb, logn),
+                          c3 = Ntt3::convolve(a, na, b, nb, logn);
+    const uint64_t p1 = 2013265921u, p2 = 2130706433u, p3 = 469762049u;
+    const uint32_t inv12 = Ntt2::pow((uint32_t)(p1 % p2), p2 - 2);                  // p1^-1 mod p2
+    const uint32_t inv123 = Ntt3::pow((uint32_t)(p1 * p2 % p3), p3 - 2);            // (p1 p2)^-1 mod p3
+    unsigned __int128 carry = 0;
+    int rn = na + nb;
+    for (int i = 0; i < rn; ++i) {
+        if (i < na + nb - 1) {
+            // Garner: x = t1 + p1 (t2 + p2 t3)
+            uint64_t t1 = c1[i];
+            uint64_t t2 = (c2[i] + p2 - t1 % p2) % p2 * inv12 % p2;
+            uint64_t t3 = (c3[i] + p3 - (t1 + p1 * t2) % p3) % p3 * inv123 % p3;
+            carry += (unsigned __int128)t1 + (unsigned __int128)p1 * (t2 + p2 * t3);
+        }
+        r[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+}
+
+// r[0..na+nb) = a * b; r must not overlap a or b. `top` forces the tier of
+// the first level (the tuner and self-test use it); below that, and with
+// AUTO, the thresholds decide.
+inline void mul(uint32_t* r, const uint32_t* a, int na, const uint32_t* b, int nb, Tier top) {
+    if (na < nb) { std::swap(a, b); std::swap(na, nb); }
+    bool sq = a == b && na == nb;
+    Tier t = top;
+    if (t == AUTO) {
+        const Thresholds& th = thresholds;
+        t = nb < th.karatsuba ? SCHOOLBOOK : nb < th.toom3 ? KARATSUBA
+          : nb < th.ntt || !nttFits(na, nb) ? TOOM3 : NTT;
+    }
+    if (t == SCHOOLBOOK || nb < 2) {
+        if (sq) BigInt::sqrWords(r, a, na); else BigInt::mulWords(r, a, na, b, nb);
+        return;
+    }
+    if (t == NTT && nttFits(na, nb)) { ntt(r, a, na, b, nb); return; }
+    if (2 * nb <= na) {
+        // Lopsided: slices of a, each about as long as b.
+        memset(r, 0, (size_t)(na + nb) * sizeof(uint32_t));
+        Scratch s(2 * nb);
+        for (int off = 0; off < na; off += nb) {
+            int len = std::min(nb, na - off);
+            mul(s.p, a + off, len, b, nb, top);
+            addTo(r + off, na + nb - off, s.p, len + nb);
+        }
+        return;
+    }
+    if (t == KARATSUBA) karatsuba(r, a, na, b, nb);
+    else toom3(r, a, na, b, nb);
+}
+
+inline void sqr(uint32_t* r, const uint32_t* a, int n, Tier top = AUTO) { mul(r, a, n, a, n, top); }
+
+} // namespace bigmul
@@ -0,0 +1,175 @@
+// Binary record format for bulk inputs/outputs, the counterpart of the
+// LSB-first hex text files. All fields are little-endian:
+//
+//   header  : magic "\x89BNR", u32 version (1), u64 count, u32 stride, u32 flags (0)
+//   records : stride == 0 -> u32 n, then n u32 limbs (least significant first);
+//                            n == 0 is the "no value" record (text "-1")
+//             stride  > 0 -> exactly `stride` u32 limbs, zero-padded, no prefix
+//
+// The first byte is not a hex digit or whitespace, so a tool can tell the two
+// formats apart from the file contents alone.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "hexcodec.h"
+#include "fastio.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "binrec assumes a little-endian host");
+
+namespace binrec {
+
+constexpr char MAGIC[4] = {'\x89', 'B', 'N', 'R'};
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint32_t stride;
+    uint32_t flags;
+};
+static_assert(sizeof(Header) == 24, "header layout");
+
+inline bool isBinary(const char* p, size_t n) {
+    return n >= sizeof(Header) && memcmp(p, MAGIC, 4) == 0;
+}
+
+// Walks the records of an in-memory file (typically a fastio::MappedInput).
+// Records stay 4-byte aligned, so limbs are handed out as pointers into it.
+class Reader {
+public:
+    // Validates the header; false if the magic, version or size is wrong.
+    bool open(const char* p, size_t n) {
+        if (!isBinary(p, n)) return false;
+        memcpy(&hdr, p, sizeof hdr);
+        if (hdr.version != VERSION || hdr.flags != 0) return false;
+        pos = p + sizeof hdr; end = p + n; left = hdr.count;
+        return !hdr.stride || (uint64_t)(end - pos) / (4ull * hdr.stride) >= hdr.count;
+    }
+
+    uint64_t count() const { return hdr.count; }
+    uint32_t stride() const { return hdr.stride; }
+
+    // Next record's limbs; false after `count` records or on a truncated file.
+    bool next(const uint32_t*& words, uint32_t& n) {
+        if (!left) return false;
+        if (hdr.stride) n = hdr.stride;
+        else {
+            if (end - pos < 4) return false;
+            memcpy(&n, pos, 4); pos += 4;
+        }
+        if ((uint64_t)(end - pos) / 4 < n) return false;
+        words = (const uint32_t*)pos;
+        pos += 4ull * n; --left;
+        return true;
+    }
+
+private:
+    Header hdr{};
+    const char* pos = nullptr;
+    const char* end = nullptr;
+    uint64_t left = 0;
+};
+
+// Emits a header and then records into a fastio::BufferedOutput. The caller
+// states the record count up front (the output is not seekable).
+class Writer {
+public:
+    explicit Writer(fastio::BufferedOutput& out) : out(out) {}
+
+    void begin(uint64_t count, uint32_t stride = 0) {
+        Header h{{MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3]}, VERSION, count, stride, 0};
+        this->stride = stride;
+        out.write((const char*)&h, sizeof h);
+    }
+
+    // n == 0 writes the "no value" record (variable stride only). With a
+    // fixed stride, n must not exceed it; the rest is zero-filled.
+    void put(const uint32_t* words, uint32_t n) {
+        if (!stride) out.write((const char*)&n, 4);
+        out.write((const char*)words, 4ull * n);
+        static const uint32_t zeros[64] = {};
+        for (uint32_t pad = stride > n ? stride - n : 0; pad; ) {
+            uint32_t k = pad < 64 ? pad : 64;
+            out.write((const char*)zeros, 4ull * k);
+            pad -= k;
+        }
+    }
+
+private:
+    fastio::BufferedOutput& out;
+    uint32_t stride = 0;
+};
+
+// Input for the tools in either format, chosen by the file's first bytes.
+// Num needs assignHex(const char*, size_t) and assignWords(const uint32_t*, int).
+class NumberInput {
+public:
+    bool open(const char* path) {
+        if (!file.open(path)) return false;
+        bin = isBinary(file.data(), file.size());
+        return !bin || reader.open(file.data(), file.size());
+    }
+    bool binary() const { return bin; }
+    // Record count from the binary header; 0 for text, where it is unknown.
+    uint64_t count() const { return bin ? reader.count() : 0; }
+
+    template <class Num>
+    bool read(Num& n) {
+        if (!bin) return fastio::read(file, n);
+        const uint32_t* w;
+        uint32_t k;
+        if (!reader.next(w, k)) return false;
+        n.assignWords(w, (int)k);
+        return true;
+    }
+
+private:
+    fastio::MappedInput file;
+    Reader reader;
+    bool bin = false;
+};
+
+// Output in either format: one number per line as text, or `count` binary
+// records. Num needs words() and wordCount().
+class NumberOutput {
+public:
+    NumberOutput() : writer(file) {}
+
+    bool open(const char* path, bool binary, uint64_t count) {
+        if (!file.open(path)) return false;
+        bin = binary;
+        if (bin) writer.begin(count);
+        return true;
+    }
+
+    template <class Num>
+    void write(const Num& n) {
+        if (bin) { writer.put(n.words(), (uint32_t)n.wordCount()); return; }
+        size_t len = 8ull * n.wordCount();
+        if (len <= fastio::BufferedOutput::BLOCK)
+            file.commit(hexcodec::encode(n.words(), n.wordCount(), file.reserve(len)));
+        else {
+            std::string tmp(len, '\0');
+            file.write(tmp.data(), hexcodec::encode(n.words(), n.wordCount(), &tmp[0]));
+        }
+        file.put('\n');
+    }
+
+    // The "no value" result: "-1" as text, an empty record as binary.
+    void writeNone() {
+        if (bin) writer.put(nullptr, 0);
+        else file.write("-1\n", 3);
+    }
+
+    bool close() { return file.close(); }
+
+private:
+    fastio::BufferedOutput file;
+    Writer writer;
+    bool bin = false;
+};
+
+} // namespace binrec
@@ -0,0 +1,92 @@
+// Base blinding for private exponentiations x^d mod n (Kocher): the
+// exponentiation sees x * r^e for a random r, never x itself, and the result
+// is multiplied by r^-1, since (x r^e)^d = x^d r when d is the private
+// exponent of e.
+//
+// Drawing r costs an exponentiation r^e and an inverse r^-1 mod n, about as
+// much as the private operation it protects. A Context draws them once per
+// key and squares both after every use, so call i blinds with r^(2^i) for
+// two modular squarings. Contexts are per thread (local()), so workers on
+// the same key never share one and the update takes no lock.
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "arena.h"
+#include "bigint.h"
+#include "rsa.h"
+
+namespace blinding {
+
+// A fresh r is drawn after this many squarings of the old one.
+constexpr uint64_t REFRESH = 1 << 16;
+constexpr size_t LOCAL_KEYS = 16;
+
+class Context {
+public:
+    Context(const BigInt& modulus, const BigInt& exponent) : n(modulus), e(exponent) { draw(); }
+
+    const BigInt& modulus() const { return n; }
+    const BigInt& exponent() const { return e; }
+
+    // x * r^e mod n, the value to raise to d.
+    BigInt blind(const BigInt& x) const { return BigInt::mulMod(x, re, n); }
+
+    // y * r^-1 mod n for y = blind(x)^d, then r <- r^2 for the next call.
+    BigInt unblind(const BigInt& y) {
+        BigInt m = BigInt::mulMod(y, rInv, n);
+        if (++uses == REFRESH) draw();
+        else { re = BigInt::mulMod(re, re, n); rInv = BigInt::mulMod(rInv, rInv, n); }
+        return m;
+    }
+
+private:
+    BigInt n, e, re, rInv;
+    uint64_t uses = 0;
+
+    // r uniform-ish in [2, n) from std::random_device, redrawn until it
+    // has an inverse.
+    void draw() {
+        std::random_device rd;
+        for (;;) {
+            BigInt r;
+            for (int i = 0, bits = n.bitLength(); i < bits; i += 32) {
+                uint32_t w = rd();
+                for (int b = 0; b < 32 && i + b < bits; ++b)
+                    if ((w >> b) & 1u) r.setBit(i + b);
+            }
+            if (r >= n) r = r % n;
+            if (r < BigInt(2)) continue;
+            rInv = modInverse(r, n);
+            if (rInv.isZero()) continue;
+            re = BigInt::powerMod<BarrettReducer>(r, e, n);
+            uses = 0;
+            return;
+        }
+    }
+};
+
+// The calling thread's context for (n, e), made on first use; the most
+// recently used LOCAL_KEYS keys are kept.
+inline Context& local(const BigInt& n, const BigInt& e) {
+    arena::pool();                                 // the pool must outlive the contexts
+    thread_local std::vector<std::unique_ptr<Context>> contexts;
+    for (size_t i = 0; i < contexts.size(); ++i)
+        if (contexts[i]->modulus() == n && contexts[i]->exponent() == e) {
+            std::rotate(contexts.begin(), contexts.begin() + i, contexts.begin() + i + 1);
+            return *contexts[0];
+        }
+    if (contexts.size() == LOCAL_KEYS) contexts.pop_back();
+    contexts.insert(contexts.begin(), std::unique_ptr<Context>(new Context(n, e)));
+    return *contexts[0];
+}
+
+// op(v) must return v^d mod n; x < n.
+template <class Op>
+BigInt apply(Context& ctx, const BigInt& x, Op&& op) {
+    return ctx.unblind(op(ctx.blind(x)));
+}
+
+} // namespace blinding
@@ -0,0 +1,276 @@
+// Small-factor finder for numbers isPrime rejects: trial division by the
+// primes below 2^16, Pollard-Brent rho, then ECM on Montgomery curves
+// (Suyama parametrisation, stage 1 to B1 with the x-only ladder, stage 2 to
+// B2 = 50 B1 by baby-step giant-step), all in the Montgomery domain of
+// MontgomeryReducer. ECM curves run on a thread pool; B1 climbs through the
+// usual table (2k, 11k, 50k, ...) as curves fail, until the time budget ends.
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "bigint.h"
+#include "rsa.h"
+#include "parallel.h"
+
+namespace factor {
+
+struct Options {
+    double seconds = 10;                           // per input number
+    int threads = 1;
+    uint64_t rhoIterations = 1 << 18;
+};
+
+// n = product(primes) * cofactor, primes ascending; cofactor is 1 unless the
+// budget ran out on a composite part.
+struct Result {
+    std::vector<BigInt> primes;
+    BigInt cofactor = BigInt(1);
+};
+
+typedef std::chrono::steady_clock clk;
+
+// Bit sieve of [0, limit]: true for primes.
+inline std::vector<bool> sieve(uint32_t limit) {
+    std::vector<bool> p(limit + 1, true);
+    p[0] = false;
+    if (limit >= 1) p[1] = false;
+    for (uint64_t i = 2; i * i <= limit; ++i)
+        if (p[i]) for (uint64_t j = i * i; j <= limit; j += i) p[j] = false;
+    return p;
+}
+
+inline uint32_t modSmall(const BigInt& n, uint32_t d) {
+    uint64_t r = 0;
+    for (int i = n.wordCount() - 1; i >= 0; --i) r = ((r << 32) | n.words()[i]) % d;
+    return (uint32_t)r;
+}
+
+inline BigInt divSmall(const BigInt& n, uint32_t d) {
+    std::vector<uint32_t> q(n.wordCount());
+    uint64_t r = 0;
+    for (int i = n.wordCount() - 1; i >= 0; --i) {
+        uint64_t cur = (r << 32) | n.words()[i];
+        q[i] = (uint32_t)(cur / d); r = cur % d;
+    }
+    return BigInt::fromWords(q.data(), (int)q.size());
+}
+
+// Residues < n, in whatever form the reducer keeps them.
+struct Field {
+    MontgomeryReducer red;
+    explicit Field(const BigInt& n) : red(n) {}
+    const BigInt& n() const { return red.n; }
+    BigInt add(const BigInt& a, const BigInt& b) const {
+        BigInt s = a + b;
+        if (s >= red.n) s -= red.n;
+        return s;
+    }
+    BigInt sub(const BigInt& a, const BigInt& b) const {
+        if (a >= b) return a - b;
+        BigInt s = a + red.n;
+        return s -= b;
+    }
+    BigInt mul(const BigInt& a, const BigInt& b) const { return red.mul(a, b); }
+    BigInt sqr(const BigInt& a) const { return red.sqr(a); }
+};
+
+// A proper factor of n from g = gcd(x, n), or 0.
+inline BigInt properFactor(const BigInt& x, const BigInt& n) {
+    BigInt g = gcd(x, n);
+    return g.isOne() || g == n ? BigInt(0) : g;
+}
+
+// Pollard-Brent rho on odd composite n, f(y) = y^2 + c, gcds batched over
+// 128 steps. 0 if nothing turned up within `iterations` steps or the deadline.
+inline BigInt rho(const BigInt& n, uint64_t iterations, clk::time_point deadline, std::mt19937_64& rng) {
+    Field f(n);
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        arena::Scope scope;
+        BigInt c = f.red.to(BigInt(rng() | 1)), y = f.red.to(BigInt(rng())), x, ys, q = f.red.one();
+        auto step = [&](const BigInt& v) { return f.add(f.sqr(v), c); };
+        BigInt g(1);
+        uint64_t steps = 0;
+        for (uint64_t r = 1; g.isOne() && steps < iterations; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; ++i) y = step(y);
+            for (uint64_t k = 0; k < r && g.isOne(); k += 128) {
+                ys = y;
+                for (uint64_t i = 0; i < std::min<uint64_t>(128, r - k); ++i) {
+                    y = step(y);
+                    q = f.mul(q, x >= y ? x - y : y - x);
+                }
+                g = gcd(q, n);
+                steps += 128;
+                if (clk::now() > deadline) return BigInt(0);
+            }
+        }
+        if (g == n) {                              // the batch overshot: replay it
+            do {
+                ys = step(ys);
+                g = gcd(x >= ys ? x - ys : ys - x, n);
+            } while (g.isOne());
+        }
+        if (!g.isOne() && !(g == n)) return g;
+    }
+    return BigInt(0);
+}
+
+// Montgomery curve B y^2 = x^3 + A x^2 + x in x:z coordinates, with
+// (A + 2) / 4 kept as the fraction a24n / a24d.
+struct Curve {
+    const Field& f;
+    BigInt a24n, a24d;
+
+    struct Point { BigInt x, z; };
+
+    Point dbl(const Point& p) const {
+        BigInt s = f.sqr(f.add(p.x, p.z)), d = f.sqr(f.sub(p.x, p.z)), t = f.sub(s, d);
+        BigInt dd = f.mul(d, a24d);
+        return Point{f.mul(s, dd), f.mul(t, f.add(dd, f.mul(t, a24n)))};
+    }
+    // p + q given diff = p - q
+    Point add(const Point& p, const Point& q, const Point& diff) const {
+        BigInt u = f.mul(f.sub(p.x, p.z), f.add(q.x, q.z));
+        BigInt v = f.mul(f.add(p.x, p.z), f.sub(q.x, q.z));
+        return Point{f.mul(diff.z, f.sqr(f.add(u, v))), f.mul(diff.x, f.sqr(f.sub(u, v)))};
+    }
+    Point mul(uint64_t k, const Point& p) const {
+        if (k == 1) return p;
+        Point r0 = p, r1 = dbl(p);
+        for (int i = 62 - __builtin_clzll(k); i >= 0; --i) {
+            if ((k >> i) & 1) { r0 = add(r1, r0, p); r1 = dbl(r1); }
+            else { r1 = add(r1, r0, p); r0 = dbl(r0); }
+        }
+        return r0;
+    }
+};
+
+// B1 schedule (GMP-ECM's table, stopped at 3M) and the curves spent on each.
+struct Level { uint32_t b1; int curves; };
+static const Level LEVELS[] = {
+    {2000, 25}, {11000, 90}, {50000, 300}, {250000, 700}, {1000000, 1800}, {3000000, 5100},
+};
+constexpr int NUM_LEVELS = sizeof(LEVELS) / sizeof(LEVELS[0]);
+constexpr uint32_t B2_FACTOR = 50;
+constexpr uint32_t D = 2310;                       // giant step, 2*3*5*7*11
+
+// Sieves up to each level's B2, built on first use and shared by the
+// threads.
+class Sieves {
+public:
+    const std::vector<bool>& get(int level) {
+        std::call_once(once[level], [&] { bits[level] = sieve(LEVELS[level].b1 * B2_FACTOR + D); });
+        return bits[level];
+    }
+private:
+    std::once_flag once[NUM_LEVELS];
+    std::vector<bool> bits[NUM_LEVELS];
+};
+
+// One curve: a proper factor of n, or 0. Gives up (0) at the deadline or
+// once `stop` is set.
+inline BigInt ecmCurve(const Field& f, int level, Sieves& sv, uint64_t sigma,
+                       clk::time_point deadline, const std::atomic<bool>& stop) {
+    arena::Scope scope;
+    const BigInt& n = f.n();
+    // u = sigma^2 - 5, v = 4 sigma, x0 = u^3, z0 = v^3,
+    // (A + 2) / 4 = (v - u)^3 (3u + v) / (16 u^3 v)
+    BigInt s = f.red.to(BigInt(sigma)), u = f.sub(f.sqr(s), f.red.to(BigInt(5)));
+    BigInt v = f.add(f.add(s, s), f.add(s, s));
+    BigInt u3 = f.mul(f.sqr(u), u), vmu = f.sub(v, u);
+    Curve c{f, f.mul(f.mul(f.sqr(vmu), vmu), f.add(f.add(f.add(u, u), u), v)), BigInt()};
+    BigInt sixteen = f.red.to(BigInt(16));
+    c.a24d = f.mul(f.mul(sixteen, u3), v);
+    Curve::Point q{u3, f.mul(f.sqr(v), v)};
+
+    uint32_t b1 = LEVELS[level].b1, b2 = b1 * B2_FACTOR;
+    const std::vector<bool>& prime = sv.get(level);
+    for (uint32_t p = 2, done = 0; p <= b1; ++p) {
+        if (!prime[p]) continue;
+        uint64_t pk = p;
+        while (pk * p <= b1) pk *= p;
+        q = c.mul(pk, q);
+        if (++done % 1024 == 0 && (stop || clk::now() > deadline)) return BigInt(0);
+    }
+    BigInt g = gcd(q.z, n);
+    if (g == n) return BigInt(0);
+    if (!g.isOne()) return g;
+
+    // Stage 2: every prime in (b1, b2] is m D +- j with j odd, j < D/2 and
+    // coprime to D; for each such prime accumulate x(mDQ) z(jQ) - x(jQ) z(mDQ),
+    // which vanishes mod p exactly when p's multiple of Q is the identity.
+    std::vector<int> js;
+    std::vector<Curve::Point> baby;
+    Curve::Point q2 = c.dbl(q), prev = q, cur = q;  // cur = jQ, prev = (j-2)Q
+    for (uint32_t j = 1; j < D / 2; j += 2) {
+        if (std::gcd(j, D) == 1) { js.push_back((int)j); baby.push_back(cur); }
+        Curve::Point next = c.add(cur, q2, j == 1 ? q : prev);   // 1Q - 2Q = -Q
+        prev = cur; cur = next;
+    }
+    uint32_t m0 = std::max<uint32_t>(1, b1 / D);
+    Curve::Point step = c.mul(D, q), t = c.mul((uint64_t)m0 * D, q), tNext = c.mul((uint64_t)(m0 + 1) * D, q);
+    BigInt acc = f.red.one();
+    for (uint32_t m = m0; (uint64_t)m * D - D / 2 <= b2; ++m) {
+        for (size_t i = 0; i < js.size(); ++i) {
+            uint64_t lo = (uint64_t)m * D - js[i], hi = (uint64_t)m * D + js[i];
+            bool hit = (lo > b1 && lo <= b2 && prime[lo]) || (hi > b1 && hi <= b2 && prime[hi]);
+            if (hit) acc = f.mul(acc, f.sub(f.mul(t.x, baby[i].z), f.mul(baby[i].x, t.z)));
+        }
+        Curve::Point after = c.add(tNext, step, t);  // (m+2) D Q
+        t = tNext; tNext = after;
+        if (m % 64 == 0 && (stop || clk::now() > deadline)) return BigInt(0);
+    }
+    return properFactor(acc, n);
+}
+
+// ECM on odd composite n across opt.threads threads until a factor turns
+// up or the deadline passes; 0 on failure.
+inline BigInt ecm(const BigInt& n, const Options& opt, clk::time_point deadline, Sieves& sv) {
+    Field f(n);
+    std::atomic<int> curve{0};
+    return parallel::firstOf(opt.threads, [&](std::mt19937_64& rng, const std::atomic<bool>& stop) {
+        while (!stop && clk::now() < deadline) {
+            int idx = curve++, level = 0;
+            for (int sum = LEVELS[0].curves; level + 1 < NUM_LEVELS && idx >= sum; sum += LEVELS[++level].curves) {}
+            BigInt g = ecmCurve(f, level, sv, 6 + rng() % 0xFFFFFFF0u, deadline, stop);
+            if (!g.isZero()) return g;
+        }
+        return BigInt(0);
+    });
+}
+
+inline Result factorize(const BigInt& n, const Options& opt = Options()) {
+    Result res;
+    if (n < BigInt(2)) { res.cofactor = n; return res; }
+    auto deadline = clk::now() + std::chrono::duration_cast<clk::duration>(std::chrono::duration<double>(opt.seconds));
+    static const std::vector<bool> small = sieve(1 << 16);
+    BigInt m = n;
+    for (uint32_t p = 2; p < small.size() && !m.isOne(); ++p) {
+        if (!small[p]) continue;
+        while (modSmall(m, p) == 0) { res.primes.push_back(BigInt(p)); m = divSmall(m, p); }
+        if (m.bitLength() <= 32 && (uint64_t)p * p > m.words()[0]) break;   // m is 1 or prime
+    }
+    std::vector<BigInt> todo;
+    if (!m.isOne()) todo.push_back(m);
+    std::mt19937_64 rng(std::random_device{}());
+    Sieves sv;
+    while (!todo.empty()) {
+        BigInt c = std::move(todo.back());
+        todo.pop_back();
+        if (isPrime(c)) { res.primes.push_back(c); continue; }
+        BigInt d = rho(c, opt.rhoIterations, deadline, rng);
+        if (d.isZero()) d = ecm(c, opt, deadline, sv);
+        if (d.isZero()) { res.cofactor = res.cofactor * c; continue; }
+        todo.push_back(c / d);
+        todo.push_back(std::move(d));
+    }
+    std::sort(res.primes.begin(), res.primes.end());
+    return res;
+}
+
+} // namespace factor
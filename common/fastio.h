@@ -0,0 +1,178 @@
+// File I/O for the project tools without iostreams: the input is mapped and
+// tokenised in place (numbers are decoded straight from the mapping, no
+// std::string per token), the output is collected in a large block and
+// handed to write(2) only when the block fills up or the file is closed.
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastio {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Read-only view of a whole input file. Regular files are mmap'ed; anything
+// that cannot be mapped (pipes, /dev/stdin, empty files) is read into a
+// malloc'ed buffer instead, so callers only ever see [begin, end).
+class MappedInput {
+public:
+    MappedInput() {}
+    ~MappedInput() { close(); }
+    MappedInput(const MappedInput&) = delete;
+    MappedInput& operator=(const MappedInput&) = delete;
+
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = false;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                base = (char*)p; len = (size_t)st.st_size; mapped = true; ok = true;
+            }
+        }
+        if (!ok) ok = slurp(fd);
+        ::close(fd);
+        pos = base;
+        return ok;
+    }
+
+    void close() {
+        if (mapped) munmap(base, len);
+        else free(base);
+        base = nullptr; pos = nullptr; len = 0; mapped = false;
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return len; }
+
+    // Next whitespace-delimited token as a view into the file; false at EOF.
+    bool next(const char*& tok, size_t& n) {
+        const char* end = base + len;
+        while (pos < end && isSpace(*pos)) ++pos;
+        if (pos == end) return false;
+        tok = pos;
+        while (pos < end && !isSpace(*pos)) ++pos;
+        n = (size_t)(pos - tok);
+        return true;
+    }
+
+private:
+    bool slurp(int fd) {
+        size_t cap = 1 << 16;
+        base = (char*)malloc(cap);
+        if (!base) return false;
+        for (;;) {
+            if (len == cap) {
+                char* grown = (char*)realloc(base, cap *= 2);
+                if (!grown) return false;
+                base = grown;
+            }
+            ssize_t r = read(fd, base + len, cap - len);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) return false;
+            if (r == 0) return true;
+            len += (size_t)r;
+        }
+    }
+
+    char* base = nullptr;
+    const char* pos = nullptr;
+    size_t len = 0;
+    bool mapped = false;
+};
+
+// Reads the next token into n through n.assignHex; n is left untouched at EOF.
+template <class Num>
+inline bool read(MappedInput& in, Num& n) {
+    const char* tok;
+    size_t len;
+    if (!in.next(tok, len)) return false;
+    n.assignHex(tok, len);
+    return true;
+}
+
+// Block-buffered output file. Formatters reserve space and encode directly
+// into the buffer; close() (or the destructor) flushes the tail.
+class BufferedOutput {
+public:
+    static constexpr size_t BLOCK = 1 << 20;
+
+    BufferedOutput() {}
+    ~BufferedOutput() { close(); }
+    BufferedOutput(const BufferedOutput&) = delete;
+    BufferedOutput& operator=(const BufferedOutput&) = delete;
+
+    bool open(const char* path) {
+        close();
+        fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) return false;
+        buf = (char*)malloc(BLOCK);
+        if (!buf) { ::close(fd); fd = -1; return false; }
+        used = 0; failed = false;
+        return true;
+    }
+
+    // Returns room for at least n bytes (n <= BLOCK); follow with commit().
+    char* reserve(size_t n) {
+        if (used + n > BLOCK) flush();
+        return buf + used;
+    }
+    void commit(size_t n) { used += n; }
+
+    void write(const char* s, size_t n) {
+        while (n) {
+            if (used == BLOCK) flush();
+            size_t k = BLOCK - used < n ? BLOCK - used : n;
+            memcpy(buf + used, s, k);
+            used += k; s += k; n -= k;
+        }
+    }
+    void put(char c) { *reserve(1) = c; ++used; }
+
+    bool flush() {
+        const char* p = buf;
+        while (used && !failed) {
+            ssize_t w = ::write(fd, p, used);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) { failed = true; break; }
+            p += w; used -= (size_t)w;
+        }
+        used = 0;
+        return !failed;
+    }
+
+    // Flushes and closes; false if any write failed.
+    bool close() {
+        if (fd < 0) return !failed;
+        flush();
+        if (::close(fd) != 0) failed = true;
+        fd = -1;
+        free(buf); buf = nullptr;
+        return !failed;
+    }
+
+private:
+    int fd = -1;
+    char* buf = nullptr;
+    size_t used = 0;
+    bool failed = false;
+};
+
+inline BufferedOutput& operator<<(BufferedOutput& out, char c) { out.put(c); return out; }
+inline BufferedOutput& operator<<(BufferedOutput& out, const char* s) {
+    out.write(s, strlen(s));
+    return out;
+}
+
+} // namespace fastio
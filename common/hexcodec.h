@@ -0,0 +1,82 @@
+// LSB-first hex codec shared by the project tools: character i of the text is
+// h_i in h_0*16^0 + h_1*16^1 + ..., i.e. bits [4i, 4i+4) of the number, so
+// eight consecutive characters are exactly one 32-bit limb.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace hexcodec {
+
+// Digit value per byte; anything that is not a hex digit counts as 0 (the
+// position still advances), which is what the old per-character loop did.
+struct DigitTable {
+    uint8_t v[256];
+    constexpr DigitTable() : v() {
+        for (int c = '0'; c <= '9'; ++c) v[c] = (uint8_t)(c - '0');
+        for (int c = 'A'; c <= 'F'; ++c) v[c] = (uint8_t)(c - 'A' + 10);
+        for (int c = 'a'; c <= 'f'; ++c) v[c] = (uint8_t)(c - 'a' + 10);
+    }
+};
+static constexpr DigitTable kDigits{};
+
+// One limb -> 8 uppercase digits packed LSB-first into a little-endian word:
+// spread the nibbles one per byte, then add '0', plus 7 where the nibble is
+// >= 10 (nibble + 6 carries into bit 4 exactly then).
+inline uint64_t encodeLimb(uint32_t w) {
+    uint64_t t = w;
+    t = (t | (t << 16)) & 0x0000FFFF0000FFFFull;
+    t = (t | (t << 8))  & 0x00FF00FF00FF00FFull;
+    t = (t | (t << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    uint64_t letters = ((t + 0x0606060606060606ull) >> 4) & 0x0101010101010101ull;
+    return t + 0x3030303030303030ull + letters * 7;
+}
+
+// 8 digits -> one limb. The SWAR nibble formula is only right for '0'-'9'
+// and 'A'-'F', so the block is re-encoded and compared; any other byte
+// (lowercase, junk) sends it through the table instead.
+inline uint32_t decodeLimb(const char* s) {
+    uint64_t x;
+    memcpy(&x, s, 8);
+    uint64_t v = (x & 0x0F0F0F0F0F0F0F0Full) + ((x >> 6) & 0x0101010101010101ull) * 9;
+    v = (v | (v >> 4)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v >> 8)) & 0x0000FFFF0000FFFFull;
+    uint32_t w = (uint32_t)(v | (v >> 16));
+    if (encodeLimb(w) == x) return w;
+    w = 0;
+    for (int i = 0; i < 8; ++i) w |= (uint32_t)kDigits.v[(uint8_t)s[i]] << (4 * i);
+    return w;
+}
+
+// Decodes s[0..len) into words[0..maxWords) (zeroing it first); digits past
+// maxWords limbs are dropped. Returns the number of limbs touched (>= 1),
+// before normalisation.
+inline int decode(const char* s, size_t len, uint32_t* words, int maxWords) {
+    memset(words, 0, (size_t)maxWords * sizeof(uint32_t));
+    size_t full = len / 8;
+    if (full > (size_t)maxWords) full = (size_t)maxWords;
+    for (size_t w = 0; w < full; ++w) words[w] = decodeLimb(s + 8 * w);
+    int used = (int)full;
+    if (full < (size_t)maxWords && len > 8 * full) {
+        uint32_t w = 0;
+        for (size_t i = 8 * full; i < len; ++i)
+            w |= (uint32_t)kDigits.v[(uint8_t)s[i]] << (4 * (i - 8 * full));
+        words[used++] = w;
+    }
+    return used > 0 ? used : 1;
+}
+
+// Encodes words[0..size) (normalised, top limb nonzero unless size == 1)
+// into out, which must hold 8*size bytes. Returns the digit count; zero is "0".
+inline size_t encode(const uint32_t* words, int size, char* out) {
+    if (size == 1 && words[0] == 0) { out[0] = '0'; return 1; }
+    for (int w = 0; w < size; ++w) {
+        uint64_t d = encodeLimb(words[w]);
+        memcpy(out + 8 * w, &d, 8);
+    }
+    int topDigits = 0;
+    for (uint32_t top = words[size - 1]; top; top >>= 4) ++topDigits;
+    return (size_t)(8 * (size - 1) + topDigits);
+}
+
+} // namespace hexcodec
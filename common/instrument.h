@@ -0,0 +1,95 @@
+// Operation counters and phase timers, compiled in with -DBIGINT_INSTRUMENT
+// and absent otherwise (the macros expand to nothing).
+//
+//   INSTRUMENT_COUNT(MUL)     one more of: MUL, SQR (BigInt products and
+//                             squares), REDUCE (Barrett, Montgomery or
+//                             division reductions), DIV_STEP (quotient limbs
+//                             produced by the schoolbook divisions),
+//                             CONSTRUCT, COPY (BigInt constructions, deep copies)
+//   INSTRUMENT_PHASE(PARSE)   this thread is now in PARSE, COMPUTE or EMIT;
+//                             the time since the last switch goes to the
+//                             phase it ends
+//   INSTRUMENT_IDLE()         ends the current phase (a pipeline stage
+//                             waiting on its queue)
+//
+// Counts are plain thread-locals, added to the process totals when the
+// thread exits. At exit the totals are written as one line of JSON to the
+// file named by $BIGINT_STATS, or to stderr.
+#pragma once
+
+#ifdef BIGINT_INSTRUMENT
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+
+namespace instrument {
+
+enum Counter { MUL, SQR, REDUCE, DIV_STEP, CONSTRUCT, COPY, COUNTERS };
+enum Phase { PARSE, COMPUTE, EMIT, PHASES };
+
+typedef std::chrono::steady_clock clk;
+
+struct Totals {
+    std::atomic<uint64_t> counts[COUNTERS], ns[PHASES], threads;
+};
+inline Totals totals;
+
+struct Local {
+    uint64_t counts[COUNTERS] = {}, ns[PHASES] = {};
+    int phase = -1;
+    clk::time_point since;
+
+    void enter(int p) {
+        clk::time_point now = clk::now();
+        if (phase >= 0) ns[phase] += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count();
+        phase = p; since = now;
+    }
+    ~Local() {
+        enter(-1);
+        for (int i = 0; i < COUNTERS; ++i) totals.counts[i] += counts[i];
+        for (int i = 0; i < PHASES; ++i) totals.ns[i] += ns[i];
+        ++totals.threads;
+    }
+};
+
+inline Local& local() {
+    static thread_local Local l;
+    return l;
+}
+
+// Runs after every thread's Local, the main thread's included (thread-local
+// destructors precede static ones).
+struct Dump {
+    ~Dump() {
+        const char* path = getenv("BIGINT_STATS");
+        FILE* f = path && *path ? fopen(path, "w") : nullptr;
+        FILE* out = f ? f : stderr;
+        static const char* counter[COUNTERS] = {"mul", "sqr", "reduce", "div_steps", "constructions", "copies"};
+        static const char* phase[PHASES] = {"parse", "compute", "emit"};
+        fprintf(out, "{\"threads\": %llu, \"counters\": {", (unsigned long long)totals.threads.load());
+        for (int i = 0; i < COUNTERS; ++i)
+            fprintf(out, "%s\"%s\": %llu", i ? ", " : "", counter[i], (unsigned long long)totals.counts[i].load());
+        fprintf(out, "}, \"phases_ms\": {");
+        for (int i = 0; i < PHASES; ++i)
+            fprintf(out, "%s\"%s\": %.3f", i ? ", " : "", phase[i], totals.ns[i].load() / 1e6);
+        fprintf(out, "}}\n");
+        if (f) fclose(f);
+    }
+};
+inline Dump dump;
+
+} // namespace instrument
+
+#define INSTRUMENT_COUNT(c) (++instrument::local().counts[instrument::c])
+#define INSTRUMENT_PHASE(p) (instrument::local().enter(instrument::p))
+#define INSTRUMENT_IDLE() (instrument::local().enter(-1))
+
+#else
+
+#define INSTRUMENT_COUNT(c) ((void)0)
+#define INSTRUMENT_PHASE(p) ((void)0)
+#define INSTRUMENT_IDLE() ((void)0)
+
+#endif
@@ -0,0 +1,424 @@
+// Modular exponentiation engines on top of BigInt: the multi-lane
+// AVX2/AVX-512 Montgomery engine for batches of same-size odd moduli, the
+// radix-2^52 IFMA kernel for 1024-4096-bit moduli, and powerModBest, which
+// picks the fastest single-job path for the running CPU.
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include "bigint.h"
+#include "pipeline.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_LANES 1
+#endif
+
+#ifdef HAVE_X86_LANES
+// The engine templates below are only ever inlined into the target-specific
+// wrappers, so the vector-ABI note GCC emits for them does not apply.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+// Lane traits for the multi-buffer engine: each 64-bit lane carries one
+// 32-bit limb of an independent exponentiation, so _mul_epu32 yields the
+// full 64-bit limb product and sums of (t + a*b + carry) never overflow.
+struct LanesAvx2 {
+    static constexpr int L = 4;
+    typedef __m256i V; typedef __m256i M;
+#define LANE_FN __attribute__((target("avx2"))) static inline
+    LANE_FN V load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    LANE_FN void store(uint64_t* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+    LANE_FN V zero() { return _mm256_setzero_si256(); }
+    LANE_FN V add(V a, V b) { return _mm256_add_epi64(a, b); }
+    LANE_FN V sub(V a, V b) { return _mm256_sub_epi64(a, b); }
+    LANE_FN V mul(V a, V b) { return _mm256_mul_epu32(a, b); }
+    LANE_FN V lo(V a) { return _mm256_and_si256(a, _mm256_set1_epi64x(0xFFFFFFFFll)); }
+    LANE_FN V hi(V a) { return _mm256_srli_epi64(a, 32); }
+    LANE_FN V sign(V a) { return _mm256_srli_epi64(a, 63); }
+    LANE_FN M isZero(V a) { return _mm256_cmpeq_epi64(a, _mm256_setzero_si256()); }
+    LANE_FN V select(M m, V a, V b) { return _mm256_blendv_epi8(b, a, m); }
+#undef LANE_FN
+};
+struct LanesAvx512 {
+    static constexpr int L = 8;
+    typedef __m512i V; typedef __mmask8 M;
+#define LANE_FN __attribute__((target("avx512f"))) static inline
+    LANE_FN V load(const uint64_t* p) { return _mm512_loadu_si512(p); }
+    LANE_FN void store(uint64_t* p, V v) { _mm512_storeu_si512(p, v); }
+    LANE_FN V zero() { return _mm512_setzero_si512(); }
+    LANE_FN V add(V a, V b) { return _mm512_add_epi64(a, b); }
+    LANE_FN V sub(V a, V b) { return _mm512_sub_epi64(a, b); }
+    // maskz forms: the unmasked ones trip GCC 12's -Wmaybe-uninitialized
+    LANE_FN V mul(V a, V b) { return _mm512_maskz_mul_epu32(0xFF, a, b); }
+    LANE_FN V lo(V a) { return _mm512_and_si512(a, _mm512_set1_epi64(0xFFFFFFFFll)); }
+    LANE_FN V hi(V a) { return _mm512_maskz_srli_epi64(0xFF, a, 32); }
+    LANE_FN V sign(V a) { return _mm512_maskz_srli_epi64(0xFF, a, 63); }
+    LANE_FN M isZero(V a) { return _mm512_cmpeq_epi64_mask(a, _mm512_setzero_si512()); }
+    LANE_FN V select(M m, V a, V b) { return _mm512_mask_blend_epi64(m, b, a); }
+#undef LANE_FN
+};
+
+// Lane-wise CIOS Montgomery product out = a*b/R mod n, all arrays interleaved
+// (limb j of lane l at [j*L + l]); t is (k+2)*L scratch. out may alias a or b.
+template <class T>
+__attribute__((always_inline)) inline void laneMontMul(int k, const uint64_t* a, const uint64_t* b,
+        const uint64_t* n, const uint64_t* nInv, uint64_t* t, uint64_t* out) {
+    typedef typename T::V V;
+    const int L = T::L;
+    for (int j = 0; j < k + 2; ++j) T::store(t + j * L, T::zero());
+    for (int i = 0; i < k; ++i) {
+        V ai = T::load(a + i * L), c = T::zero(), s;
+        for (int j = 0; j < k; ++j) {
+            s = T::add(T::add(T::load(t + j * L), T::mul(ai, T::load(b + j * L))), c);
+            T::store(t + j * L, T::lo(s)); c = T::hi(s);
+        }
+        s = T::add(T::load(t + k * L), c);
+        T::store(t + k * L, T::lo(s)); T::store(t + (k + 1) * L, T::hi(s));
+        V m = T::lo(T::mul(T::load(t), T::load(nInv)));
+        s = T::add(T::load(t), T::mul(m, T::load(n)));
+        c = T::hi(s);
+        for (int j = 1; j < k; ++j) {
+            s = T::add(T::add(T::load(t + j * L), T::mul(m, T::load(n + j * L))), c);
+            T::store(t + (j - 1) * L, T::lo(s)); c = T::hi(s);
+        }
+        s = T::add(T::load(t + k * L), c);
+        T::store(t + (k - 1) * L, T::lo(s));
+        T::store(t + k * L, T::add(T::load(t + (k + 1) * L), T::hi(s)));
+    }
+    // t < 2n: subtract n once in the lanes where t >= n
+    V borrow = T::zero();
+    for (int j = 0; j < k; ++j) {
+        V d = T::sub(T::sub(T::load(t + j * L), T::load(n + j * L)), borrow);
+        borrow = T::sign(d);
+        T::store(out + j * L, T::lo(d));
+    }
+    typename T::M keep = T::isZero(T::sign(T::sub(T::load(t + k * L), borrow)));
+    for (int j = 0; j < k; ++j)
+        T::store(out + j * L, T::select(keep, T::load(out + j * L), T::load(t + j * L)));
+}
+
+// r = base^exp per lane, left-to-right; the multiply step is skipped for bit
+// positions no lane has set, so shared short exponents cost what they do in
+// scalar. base and one are in Montgomery form; bits is the (maxBits * L)
+// lane-major exponent bit table.
+template <class T>
+__attribute__((always_inline)) inline void lanePowMod(int k, int maxBits, const uint64_t* n,
+        const uint64_t* nInv, const uint64_t* base, const uint64_t* one,
+        const uint64_t* bits, uint64_t* r, uint64_t* t, uint64_t* p) {
+    const int L = T::L;
+    for (int j = 0; j < k * L; ++j) r[j] = one[j];
+    for (int i = maxBits - 1; i >= 0; --i) {
+        laneMontMul<T>(k, r, r, n, nInv, t, r);
+        const uint64_t* mask = bits + i * L;
+        bool any = false;
+        for (int l = 0; l < L; ++l) any |= mask[l] != 0;
+        if (!any) continue;
+        laneMontMul<T>(k, r, base, n, nInv, t, p);
+        typename T::M sel = T::isZero(T::load(mask));
+        for (int j = 0; j < k; ++j)
+            T::store(r + j * L, T::select(sel, T::load(r + j * L), T::load(p + j * L)));
+    }
+}
+
+__attribute__((target("avx2"))) inline void lanePowModAvx2(int k, int maxBits, const uint64_t* n,
+        const uint64_t* nInv, const uint64_t* base, const uint64_t* one,
+        const uint64_t* bits, uint64_t* r, uint64_t* t, uint64_t* p) {
+    lanePowMod<LanesAvx2>(k, maxBits, n, nInv, base, one, bits, r, t, p);
+}
+__attribute__((target("avx512f"))) inline void lanePowModAvx512(int k, int maxBits, const uint64_t* n,
+        const uint64_t* nInv, const uint64_t* base, const uint64_t* one,
+        const uint64_t* bits, uint64_t* r, uint64_t* t, uint64_t* p) {
+    lanePowMod<LanesAvx512>(k, maxBits, n, nInv, base, one, bits, r, t, p);
+}
+#pragma GCC diagnostic pop
+#endif
+
+// Widest lane engine this CPU runs: 8 (AVX-512), 4 (AVX2) or 0 (scalar only).
+inline int detectLanes() {
+#ifdef HAVE_X86_LANES
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return 8;
+    if (__builtin_cpu_supports("avx2")) return 4;
+#endif
+    return 0;
+}
+
+// Montgomery exponentiation in radix 2^52 for AVX-512 IFMA hosts. Operands
+// are n 52-bit limbs in 64-bit words (n a multiple of 8, 52n >= bits + 2) and
+// vpmadd52luq/vpmadd52huq accumulate the low/high halves of the 104-bit limb
+// products. The product is "almost" Montgomery: inputs and outputs stay below
+// 2m, and only the final conversion back subtracts m. The 32-bit scalar
+// MontgomeryReducer remains the reference (see --selftest).
+struct Ifma52Montgomery {
+    static constexpr uint64_t MASK = (1ull << 52) - 1;
+    static constexpr int MIN_BITS = 1024, MAX_BITS = 4096;
+    BigInt mod;
+    int n;
+    uint64_t k0;
+    std::vector<uint64_t> m, r2;
+
+    static bool available() {
+#ifdef HAVE_X86_LANES
+        __builtin_cpu_init();
+        static const bool ok = __builtin_cpu_supports("avx512ifma");
+        return ok;
+#else
+        return false;
+#endif
+    }
+    static bool supports(const BigInt& N) {
+        int bits = N.bitLength();
+        return !N.isEven() && bits >= MIN_BITS && bits <= MAX_BITS;
+    }
+
+    explicit Ifma52Montgomery(const BigInt& N) : mod(N) {
+        n = ((N.bitLength() + 2 + 51) / 52 + 7) / 8 * 8;
+        m = to52(N);
+        uint64_t inv = m[0];                            // m*inv == 1 mod 2^3
+        for (int i = 0; i < 5; ++i) inv *= 2 - m[0] * inv;
+        k0 = (0 - inv) & MASK;                          // -m^-1 mod 2^52
+        BigInt R; R.setBit(52 * n);
+        BigInt rm = R % N;
+        r2 = to52((rm * rm) % N);
+    }
+
+    std::vector<uint64_t> to52(const BigInt& x) const {
+        std::vector<uint64_t> r(n, 0);
+        for (int i = 0; i < n; ++i) {
+            int bit = 52 * i, w = bit / 32;
+            unsigned __int128 win = 0;
+            for (int j = 0; j < 3 && w + j < x.size; ++j)
+                win |= (unsigned __int128)x.data[w + j] << (32 * j);
+            r[i] = (uint64_t)(win >> (bit % 32)) & MASK;
+        }
+        return r;
+    }
+    BigInt from52(const uint64_t* x) const {
+        BigInt r(BigInt::Words{52 * n / 32 + 3});
+        for (int i = 0; i < n; ++i) {
+            int bit = 52 * i, w = bit / 32;
+            unsigned __int128 v = (unsigned __int128)x[i] << (bit % 32);
+            for (int j = 0; j < 3 && w + j < r.cap; ++j)
+                r.data[w + j] |= (uint32_t)(v >> (32 * j));
+        }
+        r.size = r.cap; r.normalize();
+        return r;
+    }
+
+    // out = a*b/R mod m (< 2m for a, b < 2m). out may alias a or b.
+    void mul(const uint64_t* a, const uint64_t* b, uint64_t* out) const {
+        INSTRUMENT_COUNT(MUL); INSTRUMENT_COUNT(REDUCE);
+#ifdef HAVE_X86_LANES
+        amm52(a, b, m.data(), k0, n, out);
+#else
+        (void)a; (void)b; (void)out;
+#endif
+    }
+
+#ifdef HAVE_X86_LANES
+    // The n = 8*NB accumulator limbs live in NB registers. Each step adds the
+    // low halves of a_i*b + y*m in place and the high halves into H (they
+    // belong one limb up), then shifts the accumulator down one limb, which
+    // lines H up with it again.
+    // (maskz forms: the unmasked ones trip GCC 12's -Wuninitialized)
+    __attribute__((target("avx512f"))) static inline uint64_t lane0(__m512i v) {
+        return (uint64_t)_mm_cvtsi128_si64(_mm512_maskz_extracti32x4_epi32(0xF, v, 0));
+    }
+    template <int NB>
+    __attribute__((target("avx512f,avx512ifma")))
+    static void amm52(const uint64_t* a, const uint64_t* b, const uint64_t* m,
+                      uint64_t k0, uint64_t* out) {
+        __m512i acc[NB], H[NB];
+        const __m512i zero = _mm512_setzero_si512();
+        for (int j = 0; j < NB; ++j) acc[j] = zero;
+        for (int i = 0; i < 8 * NB; ++i) {
+            uint64_t a0 = lane0(acc[0]);
+            uint64_t ab0 = (uint64_t)((unsigned __int128)a[i] * b[0]) & MASK;
+            uint64_t y = ((a0 + ab0) * k0) & MASK;
+            __m512i ai = _mm512_set1_epi64((long long)a[i]), yv = _mm512_set1_epi64((long long)y);
+            for (int j = 0; j < NB; ++j) {
+                __m512i bj = _mm512_loadu_si512(b + 8 * j), mj = _mm512_loadu_si512(m + 8 * j);
+                acc[j] = _mm512_madd52lo_epu64(_mm512_madd52lo_epu64(acc[j], ai, bj), yv, mj);
+                H[j] = _mm512_madd52hi_epu64(_mm512_madd52hi_epu64(zero, ai, bj), yv, mj);
+            }
+            // limb 0 is now a multiple of 2^52: carry it up and drop it
+            uint64_t c = lane0(acc[0]) >> 52;
+            for (int j = 0; j < NB; ++j) {
+                __m512i next = j + 1 < NB ? acc[j + 1] : zero;
+                acc[j] = _mm512_add_epi64(_mm512_maskz_alignr_epi64(0xFF, next, acc[j], 1), H[j]);
+            }
+            acc[0] = _mm512_mask_add_epi64(acc[0], 1, acc[0], _mm512_set1_epi64((long long)c));
+        }
+        uint64_t t[8 * NB], c = 0;
+        for (int j = 0; j < NB; ++j) _mm512_storeu_si512(t + 8 * j, acc[j]);
+        for (int j = 0; j < 8 * NB; ++j) {
+            uint64_t v = t[j] + c;
+            out[j] = v & MASK; c = v >> 52;
+        }
+    }
+
+    static void amm52(const uint64_t* a, const uint64_t* b, const uint64_t* m,
+                      uint64_t k0, int n, uint64_t* out) {
+        switch (n / 8) {
+        case 3: amm52<3>(a, b, m, k0, out); break;
+        case 4: amm52<4>(a, b, m, k0, out); break;
+        case 5: amm52<5>(a, b, m, k0, out); break;
+        case 6: amm52<6>(a, b, m, k0, out); break;
+        case 7: amm52<7>(a, b, m, k0, out); break;
+        case 8: amm52<8>(a, b, m, k0, out); break;
+        case 9: amm52<9>(a, b, m, k0, out); break;
+        case 10: amm52<10>(a, b, m, k0, out); break;
+        }
+    }
+#endif
+
+    // base^exp mod N, left-to-right square-and-multiply
+    BigInt powerMod(const BigInt& base, const BigInt& exp) const {
+        BigInt b = base < mod ? base : base % mod;
+        std::vector<uint64_t> x = to52(b), one(n, 0), r;
+        mul(x.data(), r2.data(), x.data());
+        one[0] = 1;
+        if (exp.isZero()) {
+            r = to52(BigInt(1));
+            mul(r.data(), r2.data(), r.data());
+        } else {
+            r = x;
+            for (int i = exp.bitLength() - 2; i >= 0; --i) {
+                mul(r.data(), r.data(), r.data());
+                if (exp.getBit(i)) mul(r.data(), x.data(), r.data());
+            }
+        }
+        mul(r.data(), one.data(), r.data());
+        BigInt y = from52(r.data());
+        if (y >= mod) y = y - mod;
+        return y;
+    }
+};
+
+// Per-modulus exponentiation state: the IFMA kernel where the CPU and
+// modulus allow it (and allowIfma), else Montgomery for odd N and Barrett for
+// even N. Built once per modulus; powerMod() only reads it, so one context can
+// serve many exponentiations, from any number of threads.
+struct ModExpContext {
+    BigInt N;
+    std::unique_ptr<Ifma52Montgomery> ifma;
+    std::unique_ptr<MontgomeryReducer> mont;
+    std::unique_ptr<BarrettReducer> barrett;
+
+    explicit ModExpContext(const BigInt& n, bool allowIfma = true) : N(n) {
+        if (N.isOne() || N.isZero()) return;          // DivReducer path answers 0
+        if (allowIfma && Ifma52Montgomery::available() && Ifma52Montgomery::supports(N))
+            ifma.reset(new Ifma52Montgomery(N));
+        else if (MontgomeryReducer::supports(N)) mont.reset(new MontgomeryReducer(N));
+        else if (BarrettReducer::supports(N)) barrett.reset(new BarrettReducer(N));
+    }
+
+    BigInt powerMod(const BigInt& x, const BigInt& k) const {
+        arena::Scope scope;
+        if (ifma) return ifma->powerMod(x, k);
+        if (mont) return run(*mont, x, k);
+        if (barrett) return run(*barrett, x, k);
+        return BigInt::powerMod<DivReducer>(x, k, N);
+    }
+
+    template <class Reducer>
+    static BigInt run(const Reducer& red, const BigInt& x, const BigInt& k) {
+        return BigInt::isShortExponent(k) ? BigInt::powerModShort(red, x, k)
+                                          : BigInt::powerModGeneric(red, x, k);
+    }
+};
+
+// Best single-job path, see ModExpContext.
+inline BigInt powerModBest(const BigInt& x, const BigInt& k, const BigInt& N,
+                           bool allowIfma = true) {
+    return ModExpContext(N, allowIfma).powerMod(x, k);
+}
+
+struct ModExpJob { BigInt N, k, x, y; };
+
+// Batch driver: with lanes == 0 every job takes the 32-bit scalar path.
+// Otherwise jobs the IFMA kernel handles go to it one at a time, and the
+// remaining odd moduli of the same word count run lock-step in groups of
+// `lanes`. Per-lane Montgomery setup and the final conversion stay scalar.
+struct LaneModExp {
+    static void run(std::vector<ModExpJob>& jobs, int lanes) {
+        std::map<int, std::vector<ModExpJob*>> groups;
+        for (auto& j : jobs) {
+            if (lanes && Ifma52Montgomery::available() && Ifma52Montgomery::supports(j.N))
+                j.y = Ifma52Montgomery(j.N).powerMod(j.x, j.k);
+            else if (lanes && !j.N.isOne() && MontgomeryReducer::supports(j.N))
+                groups[j.N.size].push_back(&j);
+            else j.y = powerModBest(j.x, j.k, j.N, false);
+        }
+        for (auto& g : groups) {
+            std::vector<ModExpJob*>& v = g.second;
+            size_t i = 0;
+            while (i + 2 <= v.size()) {
+                int used = (int)std::min(v.size() - i, (size_t)lanes);
+                runGroup(v.data() + i, used, lanes, g.first);
+                i += used;
+            }
+            for (; i < v.size(); ++i) v[i]->y = powerModBest(v[i]->x, v[i]->k, v[i]->N, false);
+        }
+    }
+
+    // `used` real jobs, padded up to L lanes by repeating the first one
+    static void runGroup(ModExpJob** jobs, int used, int L, int k) {
+        arena::Scope scope;
+        std::vector<MontgomeryReducer> red;
+        int maxBits = 0;
+        for (int l = 0; l < used; ++l) {
+            red.emplace_back(jobs[l]->N);
+            maxBits = std::max(maxBits, jobs[l]->k.bitLength());
+        }
+        std::vector<uint64_t> n(k * L), inv(L), base(k * L), one(k * L), bits((size_t)maxBits * L),
+                         r(k * L), t((k + 2) * L), p(k * L);
+        for (int l = 0; l < L; ++l) {
+            int src = l < used ? l : 0;
+            const MontgomeryReducer& m = red[src];
+            BigInt b = m.to(jobs[src]->x);
+            inv[l] = m.nInv;
+            for (int j = 0; j < k; ++j) {
+                n[j * L + l] = m.n.data[j];
+                base[j * L + l] = j < b.size ? b.data[j] : 0;
+                one[j * L + l] = j < m.rModN.size ? m.rModN.data[j] : 0;
+            }
+            for (int i = 0; i < maxBits; ++i)
+                bits[(size_t)i * L + l] = jobs[src]->k.getBit(i);
+        }
+#ifdef HAVE_X86_LANES
+        if (L == 8) lanePowModAvx512(k, maxBits, n.data(), inv.data(), base.data(), one.data(),
+                                     bits.data(), r.data(), t.data(), p.data());
+        else lanePowModAvx2(k, maxBits, n.data(), inv.data(), base.data(), one.data(),
+                            bits.data(), r.data(), t.data(), p.data());
+#endif
+        for (int l = 0; l < used; ++l) {
+            BigInt y(BigInt::Words{k});
+            for (int j = 0; j < k; ++j) y.data[j] = (uint32_t)r[j * L + l];
+            y.size = k; y.normalize();
+            jobs[l]->y = red[l].from(y);
+        }
+    }
+};
+
+// Streams "N k x" records from `in` to `out` (binrec::NumberInput /
+// NumberOutput or anything with the same read/write) through
+// pipeline::run: parsing, the lane engine on `chunk` jobs at a time and
+// formatting overlap, and results come out in input order. A short last
+// record reads as zeros.
+template <class Input, class Output>
+pipeline::Stats streamModExp(Input& in, Output& out, int lanes, int workers, size_t chunk = 64) {
+    return pipeline::run<std::vector<ModExpJob>>(workers, 8,
+        [&](std::vector<ModExpJob>& jobs) {
+            jobs.reserve(chunk);
+            while (jobs.size() < chunk) {              // read straight into the slot
+                ModExpJob& j = jobs.emplace_back();
+                if (!in.read(j.N)) { jobs.pop_back(); break; }
+                in.read(j.k) && in.read(j.x);
+            }
+            return !jobs.empty();
+        },
+        [&](std::vector<ModExpJob>& jobs) { LaneModExp::run(jobs, lanes); },
+        [&](std::vector<ModExpJob>& jobs) { for (auto& j : jobs) out.write(j.y); });
+}
@@ -0,0 +1,41 @@
+// First-result-wins search across threads, for the randomized searches of
+// primegen.h and factor.h: every thread runs the same search from its own
+// random start until one of them succeeds.
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "bigint.h"
+
+namespace parallel {
+
+// find(rng, stop) on `threads` threads (the calling thread is one of them),
+// each with its own generator seeded from one random_device draw. The first
+// non-zero answer wins and sets stop, which find should poll; find returns
+// 0 when it gives up. 0 if every thread gave up.
+template <class Find>
+BigInt firstOf(int threads, Find find) {
+    std::atomic<bool> stop{false};
+    std::mutex mu;
+    BigInt found;
+    std::random_device rd;
+    uint64_t seed = ((uint64_t)rd() << 32) | rd();
+    auto worker = [&](int id) {
+        std::mt19937_64 rng(seed + (uint64_t)id);
+        BigInt x = find(rng, stop);
+        if (x.isZero()) return;
+        std::lock_guard<std::mutex> lock(mu);
+        if (found.isZero()) found = x;
+        stop = true;
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+    return found;
+}
+
+} // namespace parallel
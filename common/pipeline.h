@@ -0,0 +1,217 @@
+// Three-stage batch pipeline: one reader thread, a pool of compute workers
+// and an ordered writer (the calling thread), connected by bounded lock-free
+// MPMC queues. Items are numbered as they are read, and the writer puts them
+// back in that order, so output order matches input order whatever the
+// workers do. The reader stays at most a fixed window of items ahead of the
+// writer, so one slow item holds up the reader instead of letting the
+// writer's reorder buffer grow with the rest of the input.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "instrument.h"
+
+namespace pipeline {
+
+// Yield first, then sleep: a blocked stage must not keep a core spinning
+// away from the stages it is waiting on.
+struct Backoff {
+    int n = 0;
+    void wait() {
+        if (++n < 16) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+};
+
+// Bounded MPMC ring (Vyukov): each cell's sequence number says whether it is
+// ready for the next push or the next pop. Capacity rounds up to a power of
+// two. push() samples the depth for the exit report.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask = n - 1;
+        cells.reset(new Cell[n]);
+        for (size_t i = 0; i < n; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(T& v) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & mask];
+            intptr_t d = (intptr_t)c.seq.load(std::memory_order_acquire) - (intptr_t)pos;
+            if (d == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(v);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (d < 0) return false;                // full
+            else pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPop(T& v) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & mask];
+            intptr_t d = (intptr_t)c.seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+            if (d == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    v = std::move(c.value);
+                    c.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (d < 0) return false;                // empty
+            else pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    void push(T v) {
+        for (Backoff b; !tryPush(v); b.wait()) {}
+        size_t d = depth();
+        pushes.fetch_add(1, std::memory_order_relaxed);
+        depthSum.fetch_add(d, std::memory_order_relaxed);
+        for (size_t m = maxDepth.load(std::memory_order_relaxed);
+             d > m && !maxDepth.compare_exchange_weak(m, d, std::memory_order_relaxed);) {}
+    }
+
+    // Blocks until an item arrives; false once the queue is closed and drained.
+    bool pop(T& v) {
+        for (Backoff b;; b.wait()) {
+            if (tryPop(v)) return true;
+            if (closed.load(std::memory_order_acquire)) return tryPop(v);
+        }
+    }
+
+    // No more pushes; call after the last push() of every producer.
+    void close() { closed.store(true, std::memory_order_release); }
+
+    size_t depth() const {
+        size_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_relaxed);
+        return h > t ? h - t : 0;
+    }
+    size_t capacity() const { return mask + 1; }
+    size_t peak() const { return maxDepth.load(); }
+    double meanDepth() const { return pushes ? (double)depthSum / pushes : 0.0; }
+
+private:
+    struct Cell { std::atomic<size_t> seq; T value; };
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<bool> closed{false};
+    std::atomic<uint64_t> pushes{0}, depthSum{0};
+    std::atomic<size_t> maxDepth{0};
+};
+
+// Per-run report: busy fraction of the wall time for each stage (compute is
+// averaged over its workers) and queue depths sampled on every push.
+struct Stats {
+    double seconds = 0;
+    uint64_t items = 0;
+    int workers = 0;
+    double readBusy = 0, computeBusy = 0, writeBusy = 0;
+    size_t inCapacity = 0, inPeak = 0, outCapacity = 0, outPeak = 0, reorderPeak = 0;
+    double inMean = 0, outMean = 0;
+
+    void print(std::ostream& os) const {
+        os << "pipeline: " << items << " items in " << seconds << " s, " << workers << " workers\n"
+           << "  utilization read=" << 100 * readBusy << "% compute=" << 100 * computeBusy
+           << "% write=" << 100 * writeBusy << "%\n"
+           << "  queue in  mean=" << inMean << " peak=" << inPeak << '/' << inCapacity << '\n'
+           << "  queue out mean=" << outMean << " peak=" << outPeak << '/' << outCapacity
+           << " reorder peak=" << reorderPeak << '\n';
+    }
+};
+
+// read(Item&) -> bool fills the next item (false at end of input),
+// compute(Item&) runs on `workers` threads, write(Item&) sees the items in
+// read order. `depth` bounds each queue, and the reader waits while as many
+// items as both queues and the workers hold are read but not yet written.
+template <class Item, class Read, class Compute, class Write>
+Stats run(int workers, size_t depth, Read&& read, Compute&& compute, Write&& write) {
+    typedef std::chrono::steady_clock clk;
+    auto ns = [](clk::time_point a, clk::time_point b) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+    };
+    struct Slot { uint64_t seq; Item item; };
+    if (workers < 1) workers = 1;
+    BoundedQueue<Slot> in(depth), out(depth);
+    const uint64_t window = in.capacity() + out.capacity() + (uint64_t)workers;
+    std::atomic<uint64_t> readNs{0}, computeNs{0}, written{0};
+    std::atomic<int> running{workers};
+    auto t0 = clk::now();
+
+    std::thread reader([&] {
+        uint64_t seq = 0, busy = 0;
+        for (;;) {
+            for (Backoff b; seq - written.load(std::memory_order_acquire) >= window; b.wait()) {}
+            Slot s{seq, Item()};
+            auto a = clk::now();
+            INSTRUMENT_PHASE(PARSE);
+            bool more = read(s.item);
+            INSTRUMENT_IDLE();
+            busy += ns(a, clk::now());
+            if (!more) break;
+            in.push(std::move(s));
+            ++seq;
+        }
+        readNs = busy;
+        in.close();
+    });
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w) pool.emplace_back([&] {
+        uint64_t busy = 0;
+        for (Slot s; in.pop(s);) {
+            auto a = clk::now();
+            INSTRUMENT_PHASE(COMPUTE);
+            compute(s.item);
+            INSTRUMENT_IDLE();
+            busy += ns(a, clk::now());
+            out.push(std::move(s));
+        }
+        computeNs += busy;
+        if (--running == 0) out.close();
+    });
+
+    Stats st;
+    uint64_t writeNs = 0;
+    std::map<uint64_t, Item> early;                    // finished ahead of their turn, < window
+    for (Slot s; out.pop(s);) {
+        early.emplace(s.seq, std::move(s.item));
+        st.reorderPeak = std::max(st.reorderPeak, early.size());
+        for (auto it = early.begin(); it != early.end() && it->first == st.items; it = early.erase(it)) {
+            auto a = clk::now();
+            INSTRUMENT_PHASE(EMIT);
+            write(it->second);
+            INSTRUMENT_IDLE();
+            writeNs += ns(a, clk::now());
+            written.store(++st.items, std::memory_order_release);
+        }
+    }
+    reader.join();
+    for (auto& t : pool) t.join();
+
+    st.seconds = std::chrono::duration<double>(clk::now() - t0).count();
+    double wall = st.seconds > 0 ? st.seconds * 1e9 : 1;
+    st.workers = workers;
+    st.readBusy = readNs / wall;
+    st.computeBusy = computeNs / wall / workers;
+    st.writeBusy = writeNs / wall;
+    st.inCapacity = in.capacity(); st.inPeak = in.peak(); st.inMean = in.meanDepth();
+    st.outCapacity = out.capacity(); st.outPeak = out.peak(); st.outMean = out.meanDepth();
+    return st;
+}
+
+} // namespace pipeline
@@ -0,0 +1,167 @@
+// Prime generation for DH groups and strong RSA factors.
+//
+//   safe    p = 2q + 1 with q prime. Candidates q run through the
+//           progression q0 + 6j (q0 = 5 mod 6, so neither q nor 2q + 1 is a
+//           multiple of 2 or 3), and one sieve pass strikes every j where a
+//           prime below 2^16 divides q or 2q + 1. Survivors take a base-2
+//           Fermat test on q, then on p, and only then Miller-Rabin on both.
+//   strong  Gordon's construction: p - 1 has the large prime factor r,
+//           p + 1 the large prime factor s, r - 1 the large prime factor t.
+//           r = 1 + 2it, p = p0 + 2jrs with p0 = 2 (s^(r-2) mod r) s - 1, and
+//           every progression is sieved the same way.
+//
+// Each search runs on `threads` threads from independent random starts; the
+// first hit sets a shared flag and the others give up at their next candidate.
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <random>
+#include <vector>
+#include "bigint.h"
+#include "rsa.h"
+#include "modexp.h"
+#include "factor.h"
+#include "parallel.h"
+
+namespace primegen {
+
+constexpr uint32_t SIEVE_LIMIT = 1 << 16;
+constexpr size_t WINDOW = 1 << 16;                 // progression terms per sieve pass
+constexpr int SAFE_MIN_BITS = 64;                  // candidates stay above the sieve primes
+constexpr int STRONG_MIN_BITS = 2 * (SAFE_MIN_BITS + 48);   // t keeps SAFE_MIN_BITS
+
+// Odd primes below SIEVE_LIMIT.
+inline const std::vector<uint32_t>& smallPrimes() {
+    static const std::vector<uint32_t> primes = [] {
+        std::vector<bool> is = factor::sieve(SIEVE_LIMIT - 1);
+        std::vector<uint32_t> p;
+        for (uint32_t i = 3; i < SIEVE_LIMIT; i += 2) if (is[i]) p.push_back(i);
+        return p;
+    }();
+    return primes;
+}
+
+// a^-1 mod prime m, a != 0 mod m.
+inline uint64_t inverseSmall(uint64_t a, uint64_t m) {
+    uint64_t r = 1, e = m - 2;
+    for (a %= m; e; e >>= 1, a = a * a % m) if (e & 1) r = r * a % m;
+    return r;
+}
+
+// alive[j] for the terms base + j * step, j < WINDOW: false where a small
+// prime divides the term or, with `safe`, twice the term plus one.
+inline void sieve(const BigInt& base, const BigInt& step, bool safe, std::vector<bool>& alive) {
+    alive.assign(WINDOW, true);
+    for (uint32_t s : smallPrimes()) {
+        uint64_t b = factor::modSmall(base, s), d = factor::modSmall(step, s);
+        if (d == 0) {                              // every term has residue b
+            if (b == 0 || (safe && (2 * b + 1) % s == 0)) { alive.assign(WINDOW, false); return; }
+            continue;
+        }
+        uint64_t inv = inverseSmall(d, s);
+        auto strike = [&](uint64_t target) {       // base + j d = target mod s
+            for (uint64_t j = (target + s - b) % s * inv % s; j < WINDOW; j += s) alive[j] = false;
+        };
+        strike(0);
+        if (safe) strike((s - 1) / 2);
+    }
+}
+
+// 2^(n-1) == 1 mod n, for odd n > 2.
+inline bool fermat2(const BigInt& n) {
+    return ModExpContext(n).powerMod(BigInt(2), n - BigInt(1)).isOne();
+}
+
+inline bool probablePrime(const BigInt& n) { return fermat2(n) && millerRabin(n, 20); }
+
+// The first term of base + j * step, j >= 0, that survives the sieve and
+// satisfies accept(); 0 once the terms outgrow maxBits or stop is set.
+template <class Accept>
+BigInt scan(BigInt base, const BigInt& step, bool safe, int maxBits, const std::atomic<bool>& stop, Accept accept) {
+    std::vector<bool> alive;
+    for (;;) {
+        sieve(base, step, safe, alive);
+        for (size_t j = 0; j < WINDOW; ++j, base += step) {
+            if (!alive[j]) continue;
+            if (base.bitLength() > maxBits || stop) return BigInt(0);
+            if (accept(base)) return base;
+        }
+    }
+}
+
+// Random value of exactly `bits` bits with the top two set.
+inline BigInt randomTop(std::mt19937_64& rng, int bits) {
+    BigInt r;
+    for (int i = 0; i < bits; i += 64) {
+        uint64_t w = rng();
+        for (int b = 0; b < 64 && i + b < bits; ++b)
+            if ((w >> b) & 1u) r.setBit(i + b);
+    }
+    r.setBit(bits - 1); r.setBit(bits - 2);
+    return r;
+}
+
+// Prime of exactly `bits` bits (>= SAFE_MIN_BITS), top two bits set.
+inline BigInt prime(int bits, int threads = 1) {
+    return parallel::firstOf(threads, [&](std::mt19937_64& rng, const std::atomic<bool>& stop) {
+        for (;;) {
+            BigInt c = randomTop(rng, bits);
+            c.setBit(0);
+            c = scan(c, BigInt(2), false, bits, stop, probablePrime);
+            if (!c.isZero() || stop) return c;
+        }
+    });
+}
+
+// Safe prime p of exactly `bits` bits (>= SAFE_MIN_BITS), top two bits set;
+// (p - 1) / 2 is prime too.
+inline BigInt safePrime(int bits, int threads = 1) {
+    return parallel::firstOf(threads, [&](std::mt19937_64& rng, const std::atomic<bool>& stop) {
+        for (;;) {
+            BigInt q = randomTop(rng, bits - 1);
+            q += BigInt((uint64_t)(5 - factor::modSmall(q, 6)));
+            q = scan(q, BigInt(6), true, bits - 1, stop, [](const BigInt& c) {
+                BigInt p = c.shiftLeft(1) + BigInt(1);
+                return fermat2(c) && fermat2(p) && millerRabin(c, 20) && millerRabin(p, 20);
+            });
+            if (stop || !q.isZero()) return q.isZero() ? q : q.shiftLeft(1) + BigInt(1);
+        }
+    });
+}
+
+// p prime, r | p - 1, s | p + 1, t | r - 1, all prime.
+struct StrongPrime { BigInt p, r, s, t; };
+
+// Gordon's strong prime of exactly `bits` bits (>= STRONG_MIN_BITS), top
+// two bits set. s has about half the bits, r and t a little less.
+inline StrongPrime strongPrime(int bits, int threads = 1) {
+    StrongPrime sp;
+    int half = bits / 2;
+    sp.s = prime(half - 24, threads);
+    sp.t = prime(half - 48, threads);
+    BigInt twoT = sp.t.shiftLeft(1);
+    sp.r = parallel::firstOf(threads, [&](std::mt19937_64& rng, const std::atomic<bool>& stop) {
+        for (;;) {
+            BigInt i((uint64_t)(rng() % (1u << 15)) + (1u << 15));
+            BigInt r = scan(i * twoT + BigInt(1), twoT, false, bits, stop, probablePrime);
+            if (!r.isZero() || stop) return r;
+        }
+    });
+    BigInt rs2 = (sp.r * sp.s).shiftLeft(1);
+    BigInt p0 = (BigInt::powerMod<MontgomeryReducer>(sp.s, sp.r - BigInt(2), sp.r) * sp.s).shiftLeft(1) - BigInt(1);
+    // Terms from 3 * 2^(bits-2) on, each thread from its own offset into
+    // the first half of the range that keeps `bits` bits.
+    BigInt low; low.setBit(bits - 1); low.setBit(bits - 2);
+    BigInt span; span.setBit(bits - 2);
+    BigInt j0 = (low - p0 + rs2 - BigInt(1)) / rs2, room = (span / rs2).shiftRight(1) + BigInt(1);
+    sp.p = parallel::firstOf(threads, [&](std::mt19937_64& rng, const std::atomic<bool>& stop) {
+        for (;;) {
+            BigInt j = j0 + BigInt((uint64_t)rng()) % room;
+            BigInt p = scan(p0 + j * rs2, rs2, false, bits, stop, probablePrime);
+            if (!p.isZero() || stop) return p;
+        }
+    });
+    return sp;
+}
+
+} // namespace primegen
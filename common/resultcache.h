@@ -0,0 +1,266 @@
+// Persistent memo of tool results across runs: an append-only log file and
+// an in-memory hash index over it, keyed by a 128-bit fingerprint of the
+// operation and the limbs of its operands (BigInt keeps them canonical, with
+// no leading zero limbs). A fingerprint collision would return a wrong
+// answer; at 128 bits that is not a practical concern for corpora of any
+// size we handle.
+//
+//   file    "RSACACH1", then records: key (2 x u64), limb count (u32),
+//           check (u32), limbs (u32 each), all little-endian
+//   open    the whole log is read into the index under a shared flock;
+//           a torn record at the end (a writer that died) is cut off
+//   store   new records are buffered and appended under an exclusive flock
+//           with O_APPEND, so several processes can share one file
+//
+// In one process, lookups take a shared lock and stores an exclusive one.
+// The tools open the file named by $RSA_CACHE (fromEnv()) and run without a
+// cache when it is unset.
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bigint.h"
+
+namespace resultcache {
+
+enum Op : uint64_t { IS_PRIME = 1, KEY_INV = 2, MOD_EXP = 3 };
+
+struct Key {
+    uint64_t lo = 0, hi = 0;
+    bool operator==(const Key& o) const { return lo == o.lo && hi == o.hi; }
+};
+
+struct KeyHash {
+    size_t operator()(const Key& k) const { return (size_t)(k.lo ^ (k.hi * 0x9E3779B97F4A7C15ull)); }
+};
+
+// Two 64-bit lanes in the shape of MurmurHash3 x64-128, fed a word at a time.
+class Hasher {
+public:
+    void add(uint64_t w) {
+        uint64_t k1 = w * C1, k2 = w * C2;
+        h1 ^= rotl(k1, 31) * C2; h1 = rotl(h1, 27) + h2; h1 = h1 * 5 + 0x52dce729;
+        h2 ^= rotl(k2, 33) * C1; h2 = rotl(h2, 31) + h1; h2 = h2 * 5 + 0x38495ab5;
+        ++count;
+    }
+    void add(const BigInt& n) {
+        add((uint64_t)n.wordCount());
+        for (int i = 0; i < n.wordCount(); i += 2)
+            add(n.words()[i] | (i + 1 < n.wordCount() ? (uint64_t)n.words()[i + 1] << 32 : 0));
+    }
+    Key finish() const {
+        uint64_t a = h1 ^ count, b = h2 ^ count;
+        a += b; b += a;
+        a = fmix(a); b = fmix(b);
+        a += b; b += a;
+        return Key{a, b};
+    }
+
+private:
+    static constexpr uint64_t C1 = 0x87c37b91114253d5ull, C2 = 0x4cf5ad432745937full;
+    uint64_t h1 = 0x6a09e667f3bcc908ull, h2 = 0xbb67ae8584caa73bull, count = 0;
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t fmix(uint64_t k) {
+        k ^= k >> 33; k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33; k *= 0xc4ceb9fe1a85ec53ull;
+        return k ^ (k >> 33);
+    }
+};
+
+inline Key fingerprint(Op op, std::initializer_list<const BigInt*> operands) {
+    Hasher h;
+    h.add((uint64_t)op);
+    for (const BigInt* n : operands) h.add(*n);
+    return h.finish();
+}
+
+class Log {
+public:
+    static constexpr size_t FLUSH_BYTES = 1 << 16;
+
+    Log() = default;
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+    ~Log() { close(); }
+
+    // Creates the file if needed and loads every complete record. False if
+    // it cannot be opened or is not a cache file.
+    bool open(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        name = path;
+        if (!load()) { ::close(fd); fd = -1; return false; }
+        return true;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    bool find(const Key& k, BigInt& value) const {
+        std::shared_lock<std::shared_mutex> lock(mu);
+        auto it = index.find(k);
+        if (it == index.end()) { ++misses; return false; }
+        value = it->second;
+        ++hits;
+        return true;
+    }
+
+    void store(const Key& k, const BigInt& value) {
+        std::unique_lock<std::shared_mutex> lock(mu);
+        if (!index.emplace(k, value).second) return;
+        ++stored;
+        uint32_t limbs = (uint32_t)value.wordCount();
+        put64(k.lo); put64(k.hi); put32(limbs); put32(check(k, value));
+        for (int i = 0; i < value.wordCount(); ++i) put32(value.words()[i]);
+        if (pending.size() >= FLUSH_BYTES) flushLocked();
+    }
+
+    // Appends the buffered records; false if the write failed.
+    bool flush() {
+        std::unique_lock<std::shared_mutex> lock(mu);
+        return flushLocked();
+    }
+
+    void close() {
+        if (fd < 0) return;
+        flush();
+        ::close(fd);
+        fd = -1;
+    }
+
+    // "cache <path>: H hits, M misses, S stored, B bytes" (B is the file size)
+    void report(std::ostream& os) {
+        flush();
+        struct stat st;
+        long long bytes = fd >= 0 && fstat(fd, &st) == 0 ? (long long)st.st_size : 0;
+        os << "cache " << name << ": " << hits << " hits, " << misses << " misses, "
+           << stored << " stored, " << bytes << " bytes\n";
+    }
+
+    uint64_t hitCount() const { return hits; }
+    uint64_t missCount() const { return misses; }
+
+private:
+    static constexpr char MAGIC[9] = "RSACACH1";
+    static constexpr size_t HEADER = 24;           // key, limb count, check
+
+    int fd = -1;
+    std::string name;
+    mutable std::shared_mutex mu;
+    std::unordered_map<Key, BigInt, KeyHash> index;
+    std::vector<unsigned char> pending;
+    mutable std::atomic<uint64_t> hits{0}, misses{0};
+    std::atomic<uint64_t> stored{0};
+
+    static uint32_t check(const Key& k, const BigInt& value) {
+        Hasher h;
+        h.add(k.lo); h.add(k.hi); h.add(value);
+        return (uint32_t)h.finish().lo;
+    }
+
+    void put32(uint32_t v) { for (int i = 0; i < 4; ++i) pending.push_back((unsigned char)(v >> (8 * i))); }
+    void put64(uint64_t v) { put32((uint32_t)v); put32((uint32_t)(v >> 32)); }
+    static uint32_t get32(const unsigned char* p) { return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+    static uint64_t get64(const unsigned char* p) { return get32(p) | (uint64_t)get32(p + 4) << 32; }
+
+    static bool writeAll(int fd, const unsigned char* p, size_t n) {
+        while (n) {
+            ssize_t w = ::write(fd, p, n);
+            if (w < 0) return false;
+            p += w; n -= (size_t)w;
+        }
+        return true;
+    }
+
+    bool flushLocked() {
+        if (pending.empty() || fd < 0) return true;
+        flock(fd, LOCK_EX);
+        bool ok = writeAll(fd, pending.data(), pending.size());
+        flock(fd, LOCK_UN);
+        pending.clear();
+        return ok;
+    }
+
+    // Reads the file under a shared lock; a new file gets the magic, a torn
+    // tail is truncated under an exclusive one.
+    bool load() {
+        flock(fd, LOCK_SH);
+        std::vector<unsigned char> buf;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        if (ok) {
+            buf.resize((size_t)st.st_size);
+            for (size_t got = 0; ok && got < buf.size();) {
+                ssize_t r = pread(fd, buf.data() + got, buf.size() - got, (off_t)got);
+                if (r <= 0) ok = false; else got += (size_t)r;
+            }
+        }
+        flock(fd, LOCK_UN);
+        if (!ok) return false;
+        if (buf.empty()) {
+            flock(fd, LOCK_EX);
+            if (fstat(fd, &st) == 0 && st.st_size == 0) ok = writeAll(fd, (const unsigned char*)MAGIC, 8);
+            flock(fd, LOCK_UN);
+            return ok && load();
+        }
+        if (buf.size() < 8 || memcmp(buf.data(), MAGIC, 8) != 0) return false;
+        size_t pos = 8;
+        std::vector<uint32_t> limbs;
+        while (buf.size() - pos >= HEADER) {
+            const unsigned char* p = buf.data() + pos;
+            Key k{get64(p), get64(p + 8)};
+            size_t n = get32(p + 16);
+            if ((buf.size() - pos - HEADER) / 4 < n) break;
+            limbs.resize(n);
+            for (size_t i = 0; i < n; ++i) limbs[i] = get32(p + HEADER + 4 * i);
+            BigInt value = BigInt::fromWords(limbs.data(), (int)n);
+            if (check(k, value) != get32(p + 20)) break;
+            index[k] = value;
+            pos += HEADER + 4 * n;
+        }
+        if (pos < buf.size()) {
+            flock(fd, LOCK_EX);
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size == buf.size()) (void)ftruncate(fd, (off_t)pos);
+            flock(fd, LOCK_UN);
+        }
+        return true;
+    }
+};
+
+// The process-wide cache named by $RSA_CACHE, opened on first use; null
+// when the variable is unset or the file is unusable (with a warning).
+inline Log* fromEnv() {
+    static Log* log = [] {
+        const char* path = getenv("RSA_CACHE");
+        if (!path || !*path) return (Log*)nullptr;
+        static Log l;
+        if (l.open(path)) return &l;
+        fprintf(stderr, "RSA_CACHE: cannot use %s, running without a cache\n", path);
+        return (Log*)nullptr;
+    }();
+    return log;
+}
+
+// compute() through the cache, or directly without one.
+template <class Compute>
+BigInt memo(Log* log, const Key& k, Compute compute) {
+    BigInt v;
+    if (log && log->find(k, v)) return v;
+    v = compute();
+    if (log) log->store(k, v);
+    return v;
+}
+
+} // namespace resultcache
@@ -0,0 +1,156 @@
+// Number theory for the RSA tools: primality (trial division + Miller-Rabin
+// through a per-n reducer), binary gcd, modular inverse and key generation.
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include "bigint.h"
+
+// Uniform-ish value in [0, n) from rand(); only used for extra Miller-Rabin
+// witnesses after the fixed ones.
+inline BigInt randomBelow(const BigInt& n) {
+    BigInt r;
+    for (int i = 0, bits = n.bitLength(); i < bits; ++i)
+        if (rand() % 2) r.setBit(i);
+    return r >= n && !n.isZero() ? r % n : r;
+}
+
+// One Miller-Rabin round for odd n > 3 and witness a. The reducer must keep
+// values as plain residues (DivReducer, BarrettReducer).
+template <class Reducer>
+bool millerRabinTest(const Reducer& red, const BigInt& n, const BigInt& a) {
+    BigInt nMinus1 = n - BigInt(1), d = nMinus1;
+    int s = 0;
+    while (d.isEven()) { ++s; d >>= 1; }
+    BigInt x = BigInt::powerModGeneric(red, a, d);
+    if (x.isOne() || x == nMinus1) return true;
+    for (int i = 0; i < s - 1; ++i) {
+        x = red.sqr(x);
+        if (x == nMinus1) return true;
+        if (x.isOne()) return false;
+    }
+    return false;
+}
+
+// The first rounds use the fixed witnesses 2, 3, ..., 37, the rest are random.
+template <class Reducer>
+bool millerRabinRounds(const Reducer& red, const BigInt& n, int iterations) {
+    static const uint64_t fixed[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    const int numFixed = sizeof(fixed) / sizeof(fixed[0]);
+    for (int i = 0; i < numFixed && i < iterations; ++i) {
+        BigInt a(fixed[i]);
+        if (a >= n) break;
+        if (!millerRabinTest(red, n, a)) return false;
+    }
+    for (int i = numFixed; i < iterations; ++i) {
+        BigInt a(2);
+        if (n >= BigInt(4)) {
+            a = randomBelow(n - BigInt(3)) + BigInt(2);
+            if (a >= n - BigInt(1)) a = BigInt(2);
+        }
+        if (!millerRabinTest(red, n, a)) return false;
+    }
+    return true;
+}
+
+// One reducer per n, shared by every witness.
+inline bool millerRabin(const BigInt& n, int iterations = 20) {
+    if (n < BigInt(2)) return false;
+    if (n == BigInt(2) || n == BigInt(3)) return true;
+    if (n.isEven()) return false;
+    if (BarrettReducer::supports(n)) return millerRabinRounds(BarrettReducer(n), n, iterations);
+    return millerRabinRounds(DivReducer(n), n, iterations);
+}
+
+// false if a prime below 100 properly divides n
+inline bool trialDivision(const BigInt& n) {
+    static const int smallPrimes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43,
+                                      47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
+    for (int p : smallPrimes) {
+        BigInt prime((uint64_t)p);
+        if (n == prime) return true;
+        if ((n % prime).isZero()) return false;
+    }
+    return true;
+}
+
+inline bool isPrime(const BigInt& n) {
+    arena::Scope scope;
+    if (n < BigInt(2)) return false;
+    if (n == BigInt(2)) return true;
+    if (n.isEven()) return false;
+    if (!trialDivision(n)) return false;
+    return millerRabin(n, 20);
+}
+
+inline BigInt phiEuler(const BigInt& p, const BigInt& q) {
+    BigInt one(1);
+    return (p - one) * (q - one);
+}
+
+// Binary (Stein) gcd
+inline BigInt gcd(const BigInt& a, const BigInt& b) {
+    if (a.isZero()) return b;
+    if (b.isZero()) return a;
+    BigInt x = a, y = b;
+    int twos = 0;
+    while (x.isEven() && y.isEven()) { x >>= 1; y >>= 1; ++twos; }
+    while (!x.isZero()) {
+        while (x.isEven()) x >>= 1;
+        while (y.isEven()) y >>= 1;
+        if (x >= y) x -= y; else y -= x;
+    }
+    y <<= twos;
+    return y;
+}
+
+// e^-1 mod phi by the extended Euclidean algorithm, with the Bezout
+// coefficient kept in [0, phi). Returns 0 when gcd(e, phi) != 1.
+inline BigInt modInverse(const BigInt& e, const BigInt& phi) {
+    arena::Scope scope;
+    if (!gcd(e, phi).isOne()) return BigInt(0);
+    BigInt r0 = phi, r1 = e, s0(0), s1(1);
+    while (!r1.isZero()) {
+        BigInt q, r2;
+        r0.divMod(r1, q, r2);
+        BigInt qs = q * s1, s2;
+        if (qs <= s0) s2 = s0 - qs;
+        else s2 = phi - ((qs - s0) % phi);   // s0 - q*s1 < 0: wrap into [0, phi)
+        r0.swap(r1); r1.swap(r2);             // (r0, r1) = (r1, r2)
+        s0.swap(s1); s1.swap(s2);
+    }
+    return s0 % phi;
+}
+
+struct RsaKey { BigInt n, e, d, p, q; };
+
+// Random prime with exactly `bits` bits, the top two set (so the product of
+// two such primes has exactly their combined width) and gcd(e, p - 1) == 1.
+// Candidate bits come from std::random_device.
+inline BigInt randomPrime(int bits, const BigInt& e, std::random_device& rd) {
+    for (;;) {
+        arena::Scope scope;
+        BigInt c;
+        for (int i = 0; i < bits; i += 32) {
+            uint32_t w = rd();
+            for (int b = 0; b < 32 && i + b < bits; ++b)
+                if ((w >> b) & 1u) c.setBit(i + b);
+        }
+        c.setBit(bits - 1); c.setBit(bits - 2); c.setBit(0);
+        if (isPrime(c) && gcd(e, c - BigInt(1)).isOne()) return c;
+    }
+}
+
+// n of exactly `bits` bits (bits >= 16), d = e^-1 mod phi(n).
+inline RsaKey generateKey(int bits, const BigInt& e) {
+    std::random_device rd;
+    RsaKey k;
+    k.e = e;
+    do {
+        k.p = randomPrime(bits - bits / 2, e, rd);
+        k.q = randomPrime(bits / 2, e, rd);
+    } while (k.p == k.q);
+    k.n = k.p * k.q;
+    k.d = modInverse(e, phiEuler(k.p, k.q));
+    return k;
+}
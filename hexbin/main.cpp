@@ -0,0 +1,162 @@
+// hexbin: converts between the LSB-first hex text files used by the project
+// tools (one number per whitespace-delimited token, "-1" for "no value") and
+// the binary record format of common/binrec.h, and measures both.
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include "../common/hexcodec.h"
+#include "../common/fastio.h"
+#include "../common/binrec.h"
+
+using namespace std;
+
+// One text token -> normalised limbs in w (empty for "-1").
+static void decodeToken(const char* tok, size_t len, vector<uint32_t>& w) {
+    if (len == 2 && tok[0] == '-' && tok[1] == '1') { w.clear(); return; }
+    w.resize(len / 8 + 1);
+    int n = hexcodec::decode(tok, len, w.data(), (int)w.size());
+    while (n > 1 && w[n - 1] == 0) --n;
+    w.resize(n);
+}
+
+static void writeText(fastio::BufferedOutput& out, const uint32_t* w, uint32_t n) {
+    while (n > 1 && w[n - 1] == 0) --n;
+    if (n == 0) { out.write("-1", 2); return; }
+    if (8ull * n > fastio::BufferedOutput::BLOCK) {
+        vector<char> tmp(8ull * n);
+        out.write(tmp.data(), hexcodec::encode(w, (int)n, tmp.data()));
+        return;
+    }
+    out.commit(hexcodec::encode(w, (int)n, out.reserve(8ull * n)));
+}
+
+// Text -> binary. stride 0 writes length-prefixed records; otherwise every
+// number must fit in `stride` limbs and "-1" is rejected.
+static int toBinary(const char* inPath, const char* outPath, uint32_t stride) {
+    fastio::MappedInput in; if (!in.open(inPath)) { cerr << "Cannot open input\n"; return 1; }
+    if (binrec::isBinary(in.data(), in.size())) { cerr << "Input is already binary\n"; return 1; }
+    uint64_t count = 0;
+    const char* tok; size_t len;
+    while (in.next(tok, len)) ++count;
+    in.open(inPath);
+
+    fastio::BufferedOutput out; if (!out.open(outPath)) { cerr << "Cannot open output\n"; return 1; }
+    binrec::Writer bin(out);
+    bin.begin(count, stride);
+    vector<uint32_t> w;
+    for (uint64_t i = 0; in.next(tok, len); ++i) {
+        decodeToken(tok, len, w);
+        if (stride && (w.empty() || w.size() > stride)) {
+            cerr << "Record " << i << " does not fit stride " << stride << '\n';
+            return 1;
+        }
+        bin.put(w.data(), (uint32_t)w.size());
+    }
+    if (!out.close()) { cerr << "Cannot write output\n"; return 1; }
+    return 0;
+}
+
+// Binary -> text, one number per line.
+static int toText(const char* inPath, const char* outPath) {
+    fastio::MappedInput in; if (!in.open(inPath)) { cerr << "Cannot open input\n"; return 1; }
+    binrec::Reader bin;
+    if (!bin.open(in.data(), in.size())) { cerr << "Not a binary record file\n"; return 1; }
+    fastio::BufferedOutput out; if (!out.open(outPath)) { cerr << "Cannot open output\n"; return 1; }
+    const uint32_t* w; uint32_t n;
+    uint64_t done = 0;
+    for (; bin.next(w, n); ++done) { writeText(out, w, n); out.put('\n'); }
+    if (done != bin.count()) { cerr << "Truncated input after " << done << " records\n"; return 1; }
+    if (!out.close()) { cerr << "Cannot write output\n"; return 1; }
+    return 0;
+}
+
+// Writes and reads the same random numbers in both formats through temp
+// files and reports MiB/s, records/s and the file sizes.
+static int runBench(int bits, double mib) {
+    using clk = chrono::steady_clock;
+    auto secs = [](clk::time_point t0) { return chrono::duration<double>(clk::now() - t0).count(); };
+    mt19937_64 rng(2024);
+    int limbs = (bits + 31) / 32;
+    size_t count = (size_t)(mib * 1048576 / (bits / 4 + 1)) + 1;
+    vector<uint32_t> all(count * limbs);
+    for (auto& x : all) x = (uint32_t)rng();
+    for (size_t i = 0; i < count; ++i) all[i * limbs + limbs - 1] |= 1u << ((bits - 1) % 32);
+    if (bits % 32) for (size_t i = 0; i < count; ++i) all[i * limbs + limbs - 1] &= (1u << (bits % 32)) - 1;
+
+    char textPath[] = "/tmp/hexbin_txt_XXXXXX", binPath[] = "/tmp/hexbin_bin_XXXXXX";
+    int f1 = mkstemp(textPath), f2 = mkstemp(binPath);
+    if (f1 < 0 || f2 < 0) { cerr << "Cannot create temp files\n"; return 1; }
+    close(f1); close(f2);
+
+    // Best of three runs each: the first write of a fresh file mostly
+    // measures the filesystem allocating blocks.
+    auto best = [&](auto&& f) {
+        double t = 1e30;
+        for (int r = 0; r < 3; ++r) { auto t0 = clk::now(); f(); t = min(t, secs(t0)); }
+        return t;
+    };
+    double wText = best([&] {
+        fastio::BufferedOutput out; out.open(textPath);
+        for (size_t i = 0; i < count; ++i) { writeText(out, &all[i * limbs], limbs); out.put('\n'); }
+    });
+    double wBin = best([&] {
+        fastio::BufferedOutput out; out.open(binPath);
+        binrec::Writer bin(out); bin.begin(count);
+        for (size_t i = 0; i < count; ++i) bin.put(&all[i * limbs], limbs);
+    });
+
+    uint64_t h1 = 0, h2 = 0;
+    size_t textBytes = 0, binBytes = 0;
+    double rText = best([&] {
+        fastio::MappedInput in; in.open(textPath); textBytes = in.size();
+        vector<uint32_t> w; const char* tok; size_t len;
+        h1 = 0;
+        while (in.next(tok, len)) { decodeToken(tok, len, w); h1 = h1 * 31 + w.back(); }
+    });
+    double rBin = best([&] {
+        fastio::MappedInput in; in.open(binPath); binBytes = in.size();
+        binrec::Reader bin; bin.open(in.data(), in.size());
+        vector<uint32_t> w; const uint32_t* p; uint32_t n;
+        h2 = 0;
+        while (bin.next(p, n)) { w.assign(p, p + n); h2 = h2 * 31 + w.back(); }
+    });
+    remove(textPath); remove(binPath);
+
+    auto row = [&](const char* what, size_t bytes, double r, double w) {
+        cout << what << " bytes=" << bytes << " read MiB/s=" << bytes / 1048576.0 / r
+             << " rec/s=" << count / r << " write MiB/s=" << bytes / 1048576.0 / w
+             << " rec/s=" << count / w << '\n';
+    };
+    cout << "bits=" << bits << " records=" << count << '\n';
+    row("text  ", textBytes, rText, wText);
+    row("binary", binBytes, rBin, wBin);
+    if (h1 != h2) { cerr << "checksum mismatch between formats\n"; return 1; }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false);
+    string cmd = argc >= 2 ? argv[1] : "";
+    if ((argc == 4 || argc == 5) && cmd == "tobin")
+        return toBinary(argv[2], argv[3], argc == 5 ? (uint32_t)strtoul(argv[4], nullptr, 10) : 0);
+    if (argc == 4 && cmd == "totext")
+        return toText(argv[2], argv[3]);
+    if (argc <= 4 && cmd == "bench") {
+        int rc = 0;
+        double mib = argc >= 3 ? atof(argv[2]) : 16.0;
+        for (int bits : {256, 1024, 4096})
+            if (argc < 4 || bits == atoi(argv[3])) rc |= runBench(bits, mib);
+        return rc;
+    }
+    cerr << "Usage: " << argv[0] << " tobin <text> <binary> [stride limbs]\n"
+         << "       " << argv[0] << " totext <binary> <text>\n"
+         << "       " << argv[0] << " bench [MiB of text] [bits]\n";
+    return 1;
+}
@@ -6,219 +6,369 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <map>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include "../common/bigint.h"
+#include "../common/rsa.h"
+#include "../common/modexp.h"
+#include "../common/blinding.h"
+#include "../common/resultcache.h"
+#include "../common/binrec.h"
 
 using namespace std;
 
-class BigInt {
-private:
-    static constexpr int MAX_WORDS = 256;
-    uint32_t data[MAX_WORDS]{};
-    int size = 1;
+// Random odd modulus with exactly `bits` bits, in the LSB-first hex format.
+static string randomHex(mt19937_64& rng, int bits, bool odd) {
+    const char* digits = "0123456789ABCDEF";
+    int len = (bits + 3) / 4;
+    string s(len, '0');
+    for (int i = 0; i < len; ++i) s[i] = digits[rng() & 0xF];
+    int topBits = bits - 4 * (len - 1);
+    int top = (int)(rng() & ((1u << topBits) - 1)) | (1 << (topBits - 1));
+    s[len - 1] = digits[top];
+    if (odd) s[0] = digits[(s[0] <= '9' ? s[0] - '0' : s[0] - 'A' + 10) | 1];
+    return s;
+}
+
+template <class F>
+static void benchOne(const char* name, const BigInt& N, uint64_t e, double seconds, F powerMod) {
+    using clk = chrono::steady_clock;
+    volatile bool sink = false;
+    int ops = 0;
+    auto t0 = clk::now();
+    double el = 0;
+    do {
+        BigInt y = powerMod();
+        sink = sink ^ y.isEven(); ++ops;
+        el = chrono::duration<double>(clk::now() - t0).count();
+    } while (el < seconds);
+    cout << "bits=" << N.bitLength() << " e=" << e << " reducer=" << name
+         << " ops=" << ops << " ops/s=" << ops / el << '\n';
+}
 
-    void normalize() {
-        while (size > 1 && data[size - 1] == 0) size--;
-        if (size == 0) size = 1;
+// Batch throughput on `count` independent same-size jobs, scalar vs lanes.
+static void benchBatch(mt19937_64& rng, int bits, int count, bool shortExp) {
+    using clk = chrono::steady_clock;
+    vector<ModExpJob> jobs(count);
+    for (auto& j : jobs) {
+        j.N = BigInt(randomHex(rng, bits, true));
+        j.k = shortExp ? BigInt(65537) : BigInt(randomHex(rng, bits, false)) % j.N;
+        j.x = BigInt(randomHex(rng, bits - 1, false));
     }
-public:
-    BigInt() = default;
-    BigInt(uint64_t v) {
-        data[0] = (uint32_t)(v & 0xFFFFFFFFu);
-        if (v > 0xFFFFFFFFu) {
-            data[1] = (uint32_t)(v >> 32);
-            size = 2;
-        }
-        normalize();
+    int best = detectLanes();
+    for (int lanes : {0, 4, 8}) {
+        if (lanes > best) break;
+        auto t0 = clk::now();
+        LaneModExp::run(jobs, lanes);
+        double el = chrono::duration<double>(clk::now() - t0).count();
+        cout << "batch bits=" << bits << " e=" << (shortExp ? "65537" : "random")
+             << " lanes=" << lanes << " jobs=" << count << " ops/s=" << count / el << '\n';
     }
+}
 
-    BigInt(const string& hex) {
-        if (hex.empty() || hex == "0") { size = 1; data[0] = 0; return; }
-        for (int i = 0; i < (int)hex.size(); ++i) {
-            char c = hex[i];
-            int d = (c>='0'&&c<='9')? c-'0' : (c>='A'&&c<='F')? c-'A'+10
-                   : (c>='a'&&c<='f')? c-'a'+10 : -1;
-            if (d < 0) continue;
-            int bitPos = i * 4;
-            int w = bitPos / 32, b = bitPos % 32;
-            if (w < MAX_WORDS) {
-                data[w] |= ((uint32_t)d << b);
-                if (b > 28 && w + 1 < MAX_WORDS)
-                    data[w + 1] |= ((uint32_t)d >> (32 - b));
-            }
-        }
-        size = MAX_WORDS; normalize();
+// Hex codec throughput over an ~8 MiB batch-style text of 2048-bit numbers.
+static void benchCodec(mt19937_64& rng) {
+    using clk = chrono::steady_clock;
+    string text;
+    while (text.size() < (8u << 20)) { text += randomHex(rng, 2048, false); text += '\n'; }
+    vector<BigInt> nums;
+    auto t0 = clk::now();
+    for (size_t i = 0; i < text.size();) {
+        size_t e = text.find('\n', i);
+        nums.emplace_back(text.data() + i, e - i);
+        i = e + 1;
     }
+    double dec = chrono::duration<double>(clk::now() - t0).count();
+    ostringstream os;
+    t0 = clk::now();
+    for (auto& n : nums) os << n << '\n';
+    double enc = chrono::duration<double>(clk::now() - t0).count();
+    double mb = text.size() / 1048576.0;
+    cout << "hex decode MiB=" << mb << " MiB/s=" << mb / dec << '\n'
+         << "hex encode MiB=" << mb << " MiB/s=" << mb / enc
+         << (os.str() == text ? "" : " (round-trip MISMATCH)") << '\n';
+}
 
-
-    bool isZero() const { return size == 1 && data[0] == 0; }
-    bool isOne()  const { return size == 1 && data[0] == 1; }
-    bool isEven() const { return (data[0] & 1u) == 0; }
-
-    int bitLength() const {
-        if (isZero()) return 0;
-        int len = (size - 1) * 32; uint32_t top = data[size - 1];
-        while (top) { ++len; top >>= 1; } return len;
-    }
-    bool getBit(int pos) const {
-        int w = pos / 32, b = pos % 32; if (w >= size) return false;
-        return (data[w] >> b) & 1u;
-    }
-    void setBit(int pos) {
-        int w = pos / 32, b = pos % 32;
-        if (w < MAX_WORDS) { data[w] |= (1u << b); if (w >= size) size = w + 1; }
+// Batch-file I/O on an ~8 MiB temp file of 256-bit numbers: iostream
+// (ifstream >> string -> BigInt, ofstream <<) against mmap + block writer.
+// Records are folded into a checksum rather than stored, so the numbers are
+// I/O and parsing, not vector growth.
+static void benchFileIo(mt19937_64& rng) {
+    using clk = chrono::steady_clock;
+    char path[] = "/tmp/p103_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { cout << "file io: no temp file, skipped\n"; return; }
+    ::close(fd);
+    vector<BigInt> pool;
+    string text;
+    while (text.size() < (8u << 20)) {
+        string h = randomHex(rng, 256, false);
+        if (pool.size() < 256) pool.emplace_back(h);
+        text += h; text += '\n';
     }
+    { ofstream(path) << text; }
+    double mb = text.size() / 1048576.0;
+    auto secs = [](clk::time_point t0) { return chrono::duration<double>(clk::now() - t0).count(); };
+    auto fold = [](uint64_t& h, const BigInt& n) { h = h * 31 + (uint64_t)n.popCount() * 1024 + n.bitLength(); };
 
-    bool operator<(const BigInt& o) const {
-        if (size != o.size) return size < o.size;
-        for (int i = size - 1; i >= 0; --i) if (data[i] != o.data[i]) return data[i] < o.data[i];
-        return false;
-    }
-    bool operator> (const BigInt& o) const { return o < *this; }
-    bool operator<=(const BigInt& o) const { return !(o < *this); }
-    bool operator>=(const BigInt& o) const { return !(*this < o); }
-    bool operator==(const BigInt& o) const {
-        if (size != o.size) return false;
-        for (int i = 0; i < size; ++i) if (data[i] != o.data[i]) return false;
-        return true;
+    uint64_t h1 = 0, h2 = 0;
+    size_t records = 0;
+    auto t0 = clk::now();
+    { ifstream in(path); BigInt n; while (in >> n) { fold(h1, n); ++records; } }
+    double readStream = secs(t0);
+    t0 = clk::now();
+    { fastio::MappedInput in; in.open(path); BigInt n; while (fastio::read(in, n)) fold(h2, n); }
+    double readMap = secs(t0);
+    t0 = clk::now();
+    { ofstream out(path); for (size_t i = 0; i < records; ++i) out << pool[i % pool.size()] << '\n'; }
+    double writeStream = secs(t0);
+    t0 = clk::now();
+    {
+        fastio::BufferedOutput out; out.open(path);
+        for (size_t i = 0; i < records; ++i) out << pool[i % pool.size()] << '\n';
     }
+    double writeBlock = secs(t0);
+    remove(path);
+    cout << "read  records=" << records << " ifstream MiB/s=" << mb / readStream
+         << " mmap MiB/s=" << mb / readMap << (h1 == h2 ? "" : " (MISMATCH)") << '\n'
+         << "write records=" << records << " ofstream MiB/s=" << mb / writeStream
+         << " block MiB/s=" << mb / writeBlock << '\n';
+}
 
-    BigInt operator+(const BigInt& o) const {
-        BigInt r; uint64_t carry = 0; int m = max(size, o.size);
-        for (int i = 0; i < m || carry; ++i) {
-            uint64_t s = carry;
-            if (i < size) s += data[i];
-            if (i < o.size) s += o.data[i];
-            r.data[i] = (uint32_t)(s & 0xFFFFFFFFu);
-            carry = s >> 32; r.size = i + 1;
+// Public-key throughput (x^e mod N) for the usual short exponents, for each
+// reducer on identical inputs, then the batch engine, hex codec and file I/O,
+// and what the limb pool on this thread went through.
+static int runBench(double seconds) {
+    mt19937_64 rng(2024);
+    const uint64_t exps[] = {3, 17, 65537};
+    for (int bits : {2048, 4096}) {
+        BigInt N(randomHex(rng, bits, true));
+        BigInt x = BigInt(randomHex(rng, bits - 1, false)) % N;
+        for (uint64_t e : exps) {
+            BigInt k(e);
+            benchOne("div", N, e, seconds, [&] { return BigInt::powerMod<DivReducer>(x, k, N); });
+            benchOne("barrett", N, e, seconds, [&] { return BigInt::powerMod<BarrettReducer>(x, k, N); });
+            benchOne("montgomery", N, e, seconds, [&] { return BigInt::powerMod<MontgomeryReducer>(x, k, N); });
+            if (Ifma52Montgomery::available())
+                benchOne("ifma52", N, e, seconds, [&] { return Ifma52Montgomery(N).powerMod(x, k); });
         }
-        r.normalize(); return r;
     }
-    BigInt operator-(const BigInt& o) const {
-        if (*this < o) return BigInt(0);
-        BigInt r; int64_t borrow = 0;
-        for (int i = 0; i < size; ++i) {
-            int64_t d = (int64_t)data[i] - borrow - (i < o.size ? o.data[i] : 0);
-            if (d < 0) { d += (1LL<<32); borrow = 1; } else borrow = 0;
-            r.data[i] = (uint32_t)d; r.size = i + 1;
+    benchBatch(rng, 2048, 64, true);
+    benchBatch(rng, 1024, 16, false);
+    benchCodec(rng);
+    benchFileIo(rng);
+    arena::Stats a = arena::stats();
+    cout << "arena allocations=" << a.allocations << " peak KiB=" << a.peak / 1024.0
+         << " high water KiB=" << a.highWater / 1024.0 << " reserved KiB=" << a.reserved / 1024
+         << " heap fallbacks=" << a.heapFallbacks << " rewinds=" << a.rewinds << '\n';
+    return 0;
+}
+
+// Cross-checks the vector kernels against the scalar 32-bit Montgomery path
+// on random odd moduli, and the ADX row and square() against the portable
+// row and operator*; returns the number of mismatches.
+static int runSelfTest() {
+    mt19937_64 rng(99);
+    int cases = 0, bad = 0;
+    if (Ifma52Montgomery::available()) {
+        for (int bits : {1024, 1025, 1536, 2048, 2049, 3072, 4095, 4096}) {
+            for (int t = 0; t < 3; ++t) {
+                BigInt N(randomHex(rng, bits, true));
+                BigInt x = BigInt(randomHex(rng, bits, false)) % N;
+                BigInt k = t == 0 ? BigInt(65537) : BigInt(randomHex(rng, t == 1 ? 64 : bits, false));
+                BigInt want = BigInt::powerMod<MontgomeryReducer>(x, k, N);
+                ++cases;
+                if (!(Ifma52Montgomery(N).powerMod(x, k) == want)) {
+                    ++bad; cerr << "ifma52 mismatch: bits=" << bits << " N=" << N << '\n';
+                }
+            }
         }
-        r.normalize(); return r;
-    }
-    BigInt shiftLeft(int n) const {
-        if (n == 0 || isZero()) return *this;
-        BigInt r; int ws = n/32, bs = n%32; r.size = min(MAX_WORDS, size + ws + (bs?1:0));
-        if (bs == 0) for (int i=0;i<size && i+ws<MAX_WORDS;++i) r.data[i+ws]=data[i];
-        else{
-            uint64_t carry=0;
-            for (int i=0;i<size && i+ws<MAX_WORDS;++i){
-                uint64_t t= ((uint64_t)data[i] << bs)|carry;
-                r.data[i+ws]=(uint32_t)(t & 0xFFFFFFFFu); carry = t >> 32;
+    } else cout << "ifma52: not available on this CPU, skipped\n";
+#ifdef __x86_64__
+    if (BigInt::pickRowKernel() != BigInt::mulAddRowPortable) {
+        for (int t = 0; t < 2000; ++t) {
+            uint32_t a[64], r1[64], r2[64], m = (uint32_t)rng();
+            int n = (int)(rng() % 65);
+            for (int i = 0; i < 64; ++i) { a[i] = (uint32_t)rng(); r1[i] = r2[i] = (uint32_t)rng(); }
+            if (t % 4 == 0) { m = ~0u; for (int i = 0; i < 64; ++i) a[i] = r1[i] = r2[i] = ~0u; }
+            ++cases;
+            if (BigInt::mulAddRowAdx(r1, a, n, m) != BigInt::mulAddRowPortable(r2, a, n, m)
+                || memcmp(r1, r2, sizeof(r1))) {
+                ++bad; cerr << "adx row mismatch: n=" << n << '\n';
             }
-            if (ws + size < MAX_WORDS && carry) r.data[ws+size]=(uint32_t)carry;
         }
-        r.normalize(); return r;
+    } else cout << "adx: not available on this CPU, skipped\n";
+#endif
+    for (int bits : {32, 33, 100, 1024, 4096}) {
+        BigInt x(randomHex(rng, bits, false));
+        ++cases;
+        if (!(x.square() == x * x)) { ++bad; cerr << "square mismatch: x=" << x << '\n'; }
     }
-    BigInt shiftRight(int n) const {
-        if (n == 0 || isZero()) return *this;
-        BigInt r; int ws = n/32, bs = n%32; if (ws >= size) return BigInt(0);
-        for (int i=ws;i<size;++i) r.data[i-ws]=data[i];
-        if (bs){
-            for (int i=0;i<size-ws;++i){
-                r.data[i] >>= bs;
-                if (i+1 < size-ws) r.data[i] |= (r.data[i+1] & ((1u<<bs)-1)) << (32-bs);
+    for (int lanes : {4, 8}) {
+        if (lanes > detectLanes()) { cout << "lanes=" << lanes << ": not available, skipped\n"; continue; }
+        vector<ModExpJob> jobs(2 * lanes + 1);
+        for (auto& j : jobs) {
+            j.N = BigInt(randomHex(rng, 512, true));
+            j.k = BigInt(randomHex(rng, 1 + rng() % 512, false));
+            j.x = BigInt(randomHex(rng, 511, false));
+        }
+        LaneModExp::run(jobs, lanes);
+        for (auto& j : jobs) {
+            ++cases;
+            if (!(j.y == BigInt::powerMod<MontgomeryReducer>(j.x, j.k, j.N))) {
+                ++bad; cerr << "lanes=" << lanes << " mismatch: N=" << j.N << '\n';
             }
         }
-        r.size = size - ws; r.normalize(); return r;
     }
-    BigInt operator*(const BigInt& o) const {
-        BigInt r; r.size = min(MAX_WORDS, size + o.size);
-        for (int i=0; i<size && i<MAX_WORDS; ++i){
-            uint64_t carry=0;
-            for (int j=0; j<o.size && i+j<MAX_WORDS; ++j){
-                uint64_t prod = (uint64_t)data[i] * o.data[j];
-                uint64_t sum  = (uint64_t)r.data[i+j] + prod + carry;
-                r.data[i+j] = (uint32_t)(sum & 0xFFFFFFFFu);
-                carry = sum >> 32;
+    // Every multiplication tier of bigmul.h, forced at the top level, against
+    // schoolbook: balanced, lopsided and squaring, random and all-ones limbs.
+    for (int na : {2, 7, 48, 49, 131, 800, 2000, 6000}) {
+        for (int nb : {na, na / 2 + 1, na / 3 + 1, 1}) {
+            vector<uint32_t> a(na), b(nb), want(na + nb), got(na + nb);
+            bool ones = rng() % 4 == 0;
+            for (auto& x : a) x = ones ? ~0u : (uint32_t)rng();
+            for (auto& x : b) x = ones ? ~0u : (uint32_t)rng();
+            const uint32_t* bp = nb == na && rng() % 2 ? a.data() : b.data();
+            BigInt::mulWords(want.data(), a.data(), na, bp, nb);
+            for (auto tier : {bigmul::KARATSUBA, bigmul::TOOM3, bigmul::NTT, bigmul::AUTO}) {
+                bigmul::mul(got.data(), a.data(), na, bp, nb, tier);
+                ++cases;
+                if (got != want) { ++bad; cerr << "multiply tier " << tier << " mismatch: " << na << "x" << nb << " limbs\n"; }
             }
-            if (i + o.size < MAX_WORDS) r.data[i+o.size] += (uint32_t)carry;
         }
-        r.normalize(); return r;
     }
-    void divMod(const BigInt& d, BigInt& q, BigInt& r) const {
-        q = BigInt(0); r = BigInt(0);
-        if (d.isZero()) return;
-        if (*this < d) { r = *this; return; }
-        if (d.isOne()) { q = *this; return; }
-        if (d.size == 1 && d.data[0]) {
-            uint64_t div = d.data[0], rem = 0;
-            q.size = size;
-            for (int i=size-1; i>=0; --i){
-                rem = (rem<<32) | data[i];
-                q.data[i] = (uint32_t)(rem / div);
-                rem %= div;
+    // Every division method of bigdiv.h, forced, and divMod twice (the
+    // second time from the reciprocal cache): q * d + r == a and r < d.
+    for (int nd : {2, 3, 61, 130, 401, 3100}) {
+        for (int nq : {1, 60, nd, 2 * nd + 5}) {
+            vector<uint32_t> w(nd + nq + nd);
+            bool ones = rng() % 4 == 0;
+            for (auto& x : w) x = ones ? ~0u : (uint32_t)rng();
+            w[nd - 1] |= 1u;
+            BigInt d = BigInt::fromWords(w.data(), nd), a = BigInt::fromWords(w.data() + nd, nq + nd - 1);
+            if (a < d) continue;
+            for (int m = bigdiv::AUTO; m <= bigdiv::NEWTON + 1; ++m) {
+                BigInt q, r;
+                if (m > bigdiv::NEWTON) a.divMod(d, q, r);
+                else bigdiv::divMod(a, d, q, r, (bigdiv::Method)m);
+                ++cases;
+                if (!(r < d) || !(q * d + r == a)) { ++bad; cerr << "divide method " << m << " wrong: " << a.wordCount() << "/" << nd << " limbs\n"; }
             }
-            q.normalize(); r.data[0] = (uint32_t)rem; r.size = 1; r.normalize(); return;
-        }
-        int bits = bitLength();
-        for (int i = bits-1; i >= 0; --i){
-            r = r.shiftLeft(1);
-            if (getBit(i)) { r.data[0] |= 1; r.normalize(); }
-            if (r >= d) { r = r - d; q.setBit(i); }
         }
-        q.normalize(); r.normalize();
     }
-    BigInt operator/(const BigInt& o) const { BigInt q,r; divMod(o,q,r); return q; }
-    BigInt operator%(const BigInt& o) const { BigInt q,r; divMod(o,q,r); return r; }
-
-    static BigInt mulMod(const BigInt& a, const BigInt& b, const BigInt& n) {
-        if (n.isOne()) return BigInt(0);
-        BigInt prod = a * b;
-        return prod % n;
+    for (int bits : {31, 64, 100, 1024}) {
+        BigInt a(randomHex(rng, bits, false)), b(randomHex(rng, bits - 7, false));
+        BigInt s = a, d = a, l = a, r = a;
+        s += b; d -= b; l <<= bits % 37; r >>= bits % 37;
+        ++cases;
+        if (!(s == a + b) || !(d == a - b) || !(l == a.shiftLeft(bits % 37)) || !(r == a.shiftRight(bits % 37))) {
+            ++bad; cerr << "in-place op mismatch: a=" << a << '\n';
+        }
     }
-    static BigInt powerMod(const BigInt& base, const BigInt& exp, const BigInt& n) {
-        if (n.isOne()) return BigInt(0);
-        BigInt result(1), b = base % n;
-        int bits = exp.bitLength();
-        for (int i = 0; i < bits; ++i) {
-            if (exp.getBit(i)) result = mulMod(result, b, n);
-            b = mulMod(b, b, n);
+    // Deep copies per call; each operation is allowed a handful of them
+    // (operand copies it has to make), not one per loop iteration.
+    {
+        BigInt N(randomHex(rng, 1024, true)), x = BigInt(randomHex(rng, 1023, false)), k(randomHex(rng, 1024, false));
+        BigInt p(randomHex(rng, 512, true)), e(65537);
+        struct Probe { const char* name; uint64_t budget; function<void()> op; };
+        Probe probes[] = {
+            {"montgomery", 8, [&] { BigInt::powerMod<MontgomeryReducer>(x, k, N); }},
+            {"barrett", 8, [&] { BigInt::powerMod<BarrettReducer>(x, k, N); }},
+            {"div", 8, [&] { BigInt::powerMod<DivReducer>(x, k, N); }},
+            {"best", 8, [&] { powerModBest(x, k, N); }},
+            {"divmod", 2, [&] { BigInt q, r; N.divMod(p, q, r); }},
+            {"gcd", 2, [&] { gcd(N, x); }},
+            {"modinv", 12, [&] { modInverse(e, N); }},
+            {"isprime", 8, [&] { isPrime(p); }},
+        };
+        cout << "copies per op:";
+        for (auto& pr : probes) {
+            uint64_t before = BigInt::copies();
+            pr.op();
+            uint64_t n = BigInt::copies() - before;
+            cout << ' ' << pr.name << '=' << n;
+            ++cases;
+            if (n > pr.budget) { ++bad; cerr << "\n" << pr.name << ": " << n << " copies, budget " << pr.budget << '\n'; }
         }
-        return result;
+        cout << '\n';
     }
+    cout << "selftest: " << cases << " cases, " << bad << " mismatches\n";
+    return bad;
+}
 
-    friend istream& operator>>(istream& is, BigInt& n);
-    friend ostream& operator<<(ostream& os, const BigInt& n);
-};
-
-istream& operator>>(istream& is, BigInt& n) {
-    string s; is >> s; n = BigInt(s); return is;
+// Batch mode: the input holds any number of "N k x" triples, the output gets
+// one y per line in the same order. lanes < 0 means auto-detect. Numbers are
+// decoded straight out of the mapped file into the job slots; a binary record
+// input gets a binary record output.
+static int runBatch(const char* inPath, const char* outPath, int lanes) {
+    binrec::NumberInput in; if (!in.open(inPath)) { cerr << "Cannot open input\n"; return 1; }
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), (in.count() + 2) / 3)) { cerr << "Cannot open output\n"; return 1; }
+    int workers = max(1, (int)thread::hardware_concurrency());
+    streamModExp(in, out, lanes < 0 ? detectLanes() : min(lanes, detectLanes()), workers).print(cerr);
+    if (!out.close()) { cerr << "Cannot write output\n"; return 1; }
+    return 0;
 }
-ostream& operator<<(ostream& os, const BigInt& n) {
-    if (n.isZero()) { os << "0"; return os; }
-    int totalHex = (n.bitLength() + 3) / 4;
-    for (int i=0; i<totalHex; ++i){
-        int bitPos = i*4, w = bitPos/32, b = bitPos%32, d = 0;
-        if (w < n.size) {
-            d = (n.data[w] >> b) & 0xF;
-            if (b > 28 && w + 1 < n.size) {
-                int k = b - 28;
-                d |= (n.data[w+1] & ((1<<k)-1)) << (32 - b);
-            }
-        }
-        os << (char)(d < 10 ? '0'+d : 'A'+(d-10));
-    }
-    return os;
+
+// Single job with a secret exponent: k is the private exponent paired with
+// public exponent e (LSB-first hex like every other number, so 65537 is
+// "10001"), x is blinded through this thread's context for (N, e),
+// and the answer is checked by raising it to e.
+static int runBlinded(const char* eHex, const char* inPath, const char* outPath) {
+    binrec::NumberInput in; if (!in.open(inPath)) { cerr << "Cannot open input\n"; return 1; }
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), 1)) { cerr << "Cannot open output\n"; return 1; }
+    BigInt N, k, x, e{string(eHex)};
+    in.read(N) && in.read(k) && in.read(x);
+    if (N < BigInt(3) || e < BigInt(2)) { cerr << "--blind: need N >= 3 and e >= 2\n"; return 1; }
+    x = x % N;
+    BigInt y = blinding::apply(blinding::local(N, e), x, [&](const BigInt& v) { return powerModBest(v, k, N); });
+    if (!(powerModBest(y, e, N) == x)) { cerr << "--blind: k is not the private exponent for e\n"; return 1; }
+    out.write(y);
+    if (!out.close()) { cerr << "Cannot write output\n"; return 1; }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     ios::sync_with_stdio(false); cin.tie(nullptr);
 
-    if (argc != 3) { cerr << "Usage: " << argv[0] << " <input> <output>\n"; return 1; }
-    ifstream in(argv[1]); if (!in) { cerr << "Cannot open input\n"; return 1; }
-    ofstream out(argv[2]); if (!out){ cerr << "Cannot open output\n"; return 1; }
+    if (argc >= 2 && string(argv[1]) == "--bench")
+        return runBench(argc >= 3 ? atof(argv[2]) : 1.0);
+    if (argc == 2 && string(argv[1]) == "--selftest")
+        return runSelfTest() ? 1 : 0;
+    if ((argc == 4 || argc == 5) && string(argv[1]) == "--batch")
+        return runBatch(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : -1);
+    if (argc == 5 && string(argv[1]) == "--blind")
+        return runBlinded(argv[2], argv[3], argv[4]);
+
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <input> <output>\n"
+             << "       " << argv[0] << " --batch <input> <output> [lanes: 0|4|8]\n"
+             << "       " << argv[0] << " --blind <e> <input> <output>   (e in LSB-first hex, 65537 = 10001; k = private exponent for e)\n"
+             << "       " << argv[0] << " --bench [seconds]\n"
+             << "       " << argv[0] << " --selftest\n";
+        return 1;
+    }
+    binrec::NumberInput in; if (!in.open(argv[1])) { cerr << "Cannot open input\n"; return 1; }
+    binrec::NumberOutput out;
+    if (!out.open(argv[2], in.binary(), 1)) { cerr << "Cannot open output\n"; return 1; }
 
+    INSTRUMENT_PHASE(PARSE);
     BigInt N, k, x;
-    in >> N >> k >> x;
+    in.read(N) && in.read(k) && in.read(x);
 
-    BigInt y = BigInt::powerMod(x, k, N);
-    out << y << '\n';
+    INSTRUMENT_PHASE(COMPUTE);
+    resultcache::Log* cache = resultcache::fromEnv();    // $RSA_CACHE, if set
+    BigInt y = resultcache::memo(cache, resultcache::fingerprint(resultcache::MOD_EXP, {&N, &k, &x}),
+                                 [&] { return powerModBest(x, k, N); });
+    INSTRUMENT_PHASE(EMIT);
+    out.write(y);
+    if (!out.close()) { cerr << "Cannot write output\n"; return 1; }
+    if (cache) cache->report(cerr);
     return 0;
 }
@@ -165,6 +165,15 @@ def verify(prog: Path, test_dir: Path, out_dir: Path, time_limit: float = 60.0)
     return failures
 
 
+def selftest(prog: Path, time_limit: float = 600.0) -> int:
+    """
+    Chạy `prog --selftest`: so khớp kernel IFMA (radix 2^52) và engine SIMD
+    nhiều lane với đường Montgomery scalar 32-bit. Trả về returncode.
+    """
+    res = subprocess.run([str(prog), "--selftest"], timeout=time_limit)
+    return res.returncode
+
+
 # =======================
 #  CLI
 # =======================
@@ -197,6 +206,10 @@ def main(argv=None):
     p_ver.add_argument("out_dir", help="Thư mục để ghi output của chương trình.")
     p_ver.add_argument("--limit", type=float, default=60.0, help="Timeout mỗi test (giây).")
 
+    # selftest
+    p_self = sub.add_parser("selftest", help="So khớp kernel SIMD/IFMA với đường scalar.")
+    p_self.add_argument("prog", help="Đường dẫn tới binary (vd: bin/p103).")
+
     args = parser.parse_args(argv)
 
     if args.cmd in ("gen", "genmix"):
@@ -205,6 +218,9 @@ def main(argv=None):
         failures = verify(Path(args.prog), Path(args.test_dir), Path(args.out_dir), args.limit)
         if failures:
             sys.exit(1)
+    elif args.cmd == "selftest":
+        if selftest(Path(args.prog)):
+            sys.exit(1)
     else:
         parser.error("unknown command")
 
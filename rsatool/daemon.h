@@ -0,0 +1,418 @@
+// rsatool serve / rsatool load: a long-running compute server on a Unix
+// domain socket and a closed-loop load generator for it (namespace rsad).
+//
+// Framing: every message is a u32 payload length followed by the payload,
+// all little-endian. Numbers travel as binrec limb arrays (u32 n, n limbs).
+//   request  : u32 id, u8 op, then the operands
+//                op 1 MODEXP   N k x   -> x^k mod N
+//                op 2 ISPRIME  n       -> 1 / 0
+//                op 3 KEYINV   p q e   -> d (status NONE if no inverse)
+//   response : u32 id, u8 status (0 OK, 1 NONE, 2 BAD_REQUEST), then the
+//              result number when status is OK
+// Requests on one connection may be answered out of order; the id pairs
+// them up. Requests are computed on a worker pool, and modexp reuses a
+// per-modulus ModExpContext from an LRU cache, so repeated moduli skip the
+// Montgomery/IFMA setup.
+//
+// Backpressure: once a connection has MAX_BACKLOG requests unanswered the
+// server stops reading it until a reply goes out, and a reply that cannot be
+// sent within SEND_TIMEOUT_MS (a client that writes but never reads) drops
+// the connection along with its queued requests.
+#pragma once
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../common/bigint.h"
+#include "../common/rsa.h"
+#include "../common/modexp.h"
+
+namespace rsad {
+
+enum Op : uint8_t { MODEXP = 1, ISPRIME = 2, KEYINV = 3 };
+enum Status : uint8_t { OK = 0, NONE = 1, BAD_REQUEST = 2 };
+constexpr uint32_t MAX_FRAME = 1 << 20;
+constexpr int MAX_BACKLOG = 256;                   // unanswered requests per connection
+constexpr int SEND_TIMEOUT_MS = 2000;
+
+inline bool readFull(int fd, void* p, size_t n) {
+    char* c = (char*)p;
+    while (n) {
+        ssize_t r = ::read(fd, c, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        c += r; n -= (size_t)r;
+    }
+    return true;
+}
+
+// With timeoutMs >= 0 the socket is written without blocking, and the
+// write gives up once that many milliseconds have passed.
+inline bool writeFull(int fd, const void* p, size_t n, int timeoutMs = -1) {
+    typedef std::chrono::steady_clock clk;
+    clk::time_point deadline = clk::now() + std::chrono::milliseconds(std::max(0, timeoutMs));
+    const char* c = (const char*)p;
+    while (n) {
+        ssize_t w = ::send(fd, c, n, MSG_NOSIGNAL | (timeoutMs >= 0 ? MSG_DONTWAIT : 0));
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeoutMs >= 0) {
+            long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clk::now()).count();
+            pollfd pfd{fd, POLLOUT, 0};
+            if (left <= 0 || (poll(&pfd, 1, (int)left) < 0 && errno != EINTR)) return false;
+            continue;
+        }
+        if (w <= 0) return false;
+        c += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+// Payload builder/parser: little-endian scalars and limb arrays.
+struct Frame {
+    std::string buf;
+    size_t pos = 0;
+
+    void putU32(uint32_t v) { buf.append((const char*)&v, 4); }
+    void putU8(uint8_t v) { buf.push_back((char)v); }
+    void putNum(const BigInt& n) {
+        putU32((uint32_t)n.wordCount());
+        buf.append((const char*)n.words(), 4 * (size_t)n.wordCount());
+    }
+    bool getU32(uint32_t& v) {
+        if (buf.size() - pos < 4) return false;
+        memcpy(&v, buf.data() + pos, 4); pos += 4; return true;
+    }
+    bool getU8(uint8_t& v) {
+        if (buf.size() - pos < 1) return false;
+        v = (uint8_t)buf[pos++]; return true;
+    }
+    bool getNum(BigInt& n) {
+        uint32_t k;
+        if (!getU32(k) || (buf.size() - pos) / 4 < k) return false;
+        std::vector<uint32_t> w(k);
+        if (k) memcpy(w.data(), buf.data() + pos, 4ull * k);
+        pos += 4ull * k;
+        n.assignWords(w.data(), (int)k);
+        return true;
+    }
+
+    bool send(int fd, int timeoutMs = -1) const {
+        uint32_t len = (uint32_t)buf.size();
+        std::string out((const char*)&len, 4);
+        out += buf;
+        return writeFull(fd, out.data(), out.size(), timeoutMs);
+    }
+    bool receive(int fd) {
+        uint32_t len;
+        if (!readFull(fd, &len, 4) || len > MAX_FRAME) return false;
+        buf.assign(len, '\0'); pos = 0;
+        return readFull(fd, &buf[0], len);
+    }
+};
+
+// LRU map modulus -> ModExpContext. Contexts are immutable once built and
+// handed out as shared_ptr, so eviction never pulls one from under a worker.
+class ContextCache {
+public:
+    explicit ContextCache(size_t capacity) : capacity(capacity) {}
+
+    std::shared_ptr<const ModExpContext> get(const BigInt& N) {
+        std::string key((const char*)N.words(), 4 * (size_t)N.wordCount());
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            auto it = index.find(key);
+            if (it != index.end()) {
+                lru.splice(lru.begin(), lru, it->second);
+                ++hits;
+                return it->second->second;
+            }
+        }
+        // Build outside the lock; two workers racing on the same new modulus
+        // both build it and the second insert is dropped.
+        auto ctx = std::make_shared<const ModExpContext>(N);
+        std::lock_guard<std::mutex> lock(mu);
+        ++misses;
+        if (index.count(key)) return ctx;
+        lru.emplace_front(key, ctx);
+        index[key] = lru.begin();
+        if (lru.size() > capacity) { index.erase(lru.back().first); lru.pop_back(); }
+        return ctx;
+    }
+
+    uint64_t hits = 0, misses = 0;
+
+private:
+    typedef std::list<std::pair<std::string, std::shared_ptr<const ModExpContext>>> List;
+    size_t capacity;
+    std::mutex mu;
+    List lru;
+    std::unordered_map<std::string, List::iterator> index;
+};
+
+// One client socket. The poll loop owns reading; workers share the write
+// side, so the fd is closed once the loop has dropped the connection and no
+// response is in flight (last shared_ptr gone).
+struct Connection {
+    int fd;
+    std::mutex writeMu;
+    std::string pending;                               // bytes of incomplete frames
+    std::atomic<int> backlog{0};                       // requests queued or computing
+    std::atomic<bool> dead{false};                     // a reply timed out or failed
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+};
+
+struct Task {
+    std::shared_ptr<Connection> conn;
+    Frame request;
+};
+
+inline volatile sig_atomic_t stopRequested = 0;
+inline void onStopSignal(int) { stopRequested = 1; }
+
+// Single poll loop for accept + reads, `workers` threads for the arithmetic.
+class Server {
+public:
+    Server(int workers, size_t cacheSize) : cache(cacheSize), workerCount(std::max(1, workers)) {}
+
+    int run(const char* path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path)) { std::cerr << "Socket path too long\n"; return 1; }
+        strcpy(addr.sun_path, path);
+        int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path);
+        if (lfd < 0 || bind(lfd, (sockaddr*)&addr, sizeof addr) || listen(lfd, 128)) {
+            std::cerr << "Cannot listen on " << path << ": " << strerror(errno) << '\n';
+            if (lfd >= 0) ::close(lfd);
+            return 1;
+        }
+        signal(SIGINT, onStopSignal);
+        signal(SIGTERM, onStopSignal);
+        signal(SIGPIPE, SIG_IGN);
+        if (pipe2(wake, O_CLOEXEC | O_NONBLOCK)) { std::cerr << "pipe: " << strerror(errno) << '\n'; ::close(lfd); return 1; }
+        for (int i = 0; i < workerCount; ++i) workers.emplace_back([this] { work(); });
+        std::cerr << "serving on " << path << " with " << workerCount << " workers\n";
+
+        std::unordered_map<int, std::shared_ptr<Connection>> conns;
+        std::vector<pollfd> fds;
+        while (!stopRequested) {
+            fds.assign({pollfd{lfd, POLLIN, 0}, pollfd{wake[0], POLLIN, 0}});
+            for (auto it = conns.begin(); it != conns.end();) {
+                if (it->second->dead) { it = conns.erase(it); continue; }
+                if (it->second->backlog < MAX_BACKLOG) fds.push_back(pollfd{it->first, POLLIN, 0});
+                ++it;
+            }
+            if (poll(fds.data(), fds.size(), 200) <= 0) continue;
+            if (fds[0].revents & POLLIN) {
+                int cfd = accept(lfd, nullptr, nullptr);
+                if (cfd >= 0) conns[cfd] = std::make_shared<Connection>(cfd);
+            }
+            if (fds[1].revents & POLLIN) {
+                char drain[64];
+                while (::read(wake[0], drain, sizeof drain) > 0) {}
+            }
+            for (size_t i = 2; i < fds.size(); ++i)
+                if (fds[i].revents && !readFrames(conns[fds[i].fd])) conns.erase(fds[i].fd);
+        }
+        conns.clear();
+        ::close(lfd);
+        unlink(path);
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) w.join();
+        ::close(wake[0]); ::close(wake[1]);
+        std::cerr << "served " << served << " requests, context cache hits " << cache.hits
+                  << " misses " << cache.misses << '\n';
+        return 0;
+    }
+
+private:
+    // Drains what the socket has and queues every complete frame; false when
+    // the peer is gone or sent an oversized frame. One read can take the
+    // backlog past MAX_BACKLOG by the frames in one chunk; the poll loop then
+    // leaves the connection alone until it drains.
+    bool readFrames(const std::shared_ptr<Connection>& conn) {
+        char chunk[1 << 16];
+        ssize_t r = ::read(conn->fd, chunk, sizeof chunk);
+        if (r < 0 && errno == EINTR) return true;
+        if (r <= 0) return false;
+        std::string& in = conn->pending;
+        in.append(chunk, (size_t)r);
+        size_t off = 0;
+        uint32_t len;
+        while (in.size() - off >= 4) {
+            memcpy(&len, in.data() + off, 4);
+            if (len > MAX_FRAME) return false;
+            if (in.size() - off - 4 < len) break;
+            Task t{conn, Frame()};
+            t.request.buf.assign(in, off + 4, len);
+            ++conn->backlog;
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                queue.push_back(std::move(t));
+            }
+            cv.notify_one();
+            off += 4 + (size_t)len;
+        }
+        in.erase(0, off);
+        return true;
+    }
+
+    void work() {
+        for (;;) {
+            Task t;
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                cv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                t = std::move(queue.front());
+                queue.pop_front();
+            }
+            Connection& c = *t.conn;
+            if (!c.dead) {                             // requests of a dropped client are skipped
+                Frame reply = handle(t.request);
+                std::lock_guard<std::mutex> lock(c.writeMu);
+                if (!c.dead && !reply.send(c.fd, SEND_TIMEOUT_MS)) {
+                    c.dead = true;                     // too slow a reader, or gone
+                    ::shutdown(c.fd, SHUT_RDWR);
+                    wakeLoop();
+                }
+                ++served;
+            }
+            if (c.backlog-- == MAX_BACKLOG) wakeLoop();    // poll it again
+        }
+    }
+
+    void wakeLoop() { char b = 0; (void)::write(wake[1], &b, 1); }
+
+    Frame handle(Frame& req) {
+        Frame reply;
+        uint32_t id = 0;
+        uint8_t op = 0;
+        BigInt a, b, c;
+        bool ok = req.getU32(id) && req.getU8(op);
+        reply.putU32(id);
+        if (ok && op == MODEXP && req.getNum(a) && req.getNum(b) && req.getNum(c)) {
+            reply.putU8(OK);
+            reply.putNum(cache.get(a)->powerMod(c, b));
+        } else if (ok && op == ISPRIME && req.getNum(a)) {
+            reply.putU8(OK);
+            reply.putNum(BigInt(isPrime(a) ? 1 : 0));
+        } else if (ok && op == KEYINV && req.getNum(a) && req.getNum(b) && req.getNum(c)) {
+            BigInt d = modInverse(c, phiEuler(a, b));
+            if (d.isZero()) reply.putU8(NONE);
+            else { reply.putU8(OK); reply.putNum(d); }
+        } else {
+            reply.putU8(BAD_REQUEST);
+        }
+        return reply;
+    }
+
+    ContextCache cache;
+    int workerCount;
+    std::vector<std::thread> workers;
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<Task> queue;                            // at most ~MAX_BACKLOG per connection
+    bool stopping = false;
+    int wake[2] = {-1, -1};                            // workers -> poll loop
+    std::atomic<uint64_t> served{0};
+};
+
+inline int connectTo(const char* path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof addr)) { ::close(fd); fd = -1; }
+    return fd;
+}
+
+// Closed-loop load: `concurrency` connections, each with one request in
+// flight, `requests` modexp calls in total with e = 65537 over `moduli`
+// distinct random odd `bits`-bit moduli (so the context cache is hot).
+// Every 64th answer is checked against a local powerModBest.
+inline int runLoad(const char* path, int requests, int concurrency, int bits, int moduli) {
+    typedef std::chrono::steady_clock clk;
+    std::mt19937_64 rng(7);
+    auto randomBits = [&](int nbits) {
+        BigInt r;
+        for (int i = 0; i < nbits; ++i) if (rng() & 1) r.setBit(i);
+        return r;
+    };
+    std::vector<BigInt> mods;
+    for (int i = 0; i < moduli; ++i) {
+        BigInt N = randomBits(bits);
+        N.setBit(bits - 1); N.setBit(0);
+        mods.push_back(N);
+    }
+    std::vector<BigInt> xs;
+    for (int i = 0; i < 64; ++i) xs.push_back(randomBits(bits - 1));
+    const BigInt e(65537);
+
+    std::vector<std::vector<double>> lat(concurrency);
+    std::atomic<int> next{0}, failures{0}, wrong{0};
+    auto t0 = clk::now();
+    std::vector<std::thread> clients;
+    for (int c = 0; c < concurrency; ++c) clients.emplace_back([&, c] {
+        int fd = connectTo(path);
+        if (fd < 0) { ++failures; return; }
+        for (int i; (i = next++) < requests;) {
+            const BigInt& N = mods[i % mods.size()];
+            const BigInt& x = xs[i % xs.size()];
+            Frame req, rep;
+            req.putU32((uint32_t)i); req.putU8(MODEXP);
+            req.putNum(N); req.putNum(e); req.putNum(x);
+            auto s = clk::now();
+            uint32_t id; uint8_t status; BigInt y;
+            if (!req.send(fd) || !rep.receive(fd) || !rep.getU32(id) || !rep.getU8(status)
+                || id != (uint32_t)i || status != OK || !rep.getNum(y)) { ++failures; break; }
+            lat[c].push_back(std::chrono::duration<double, std::micro>(clk::now() - s).count());
+            if (i % 64 == 0 && !(y == powerModBest(x, e, N))) ++wrong;
+        }
+        ::close(fd);
+    });
+    for (auto& t : clients) t.join();
+    double el = std::chrono::duration<double>(clk::now() - t0).count();
+
+    std::vector<double> all;
+    for (auto& v : lat) all.insert(all.end(), v.begin(), v.end());
+    if (all.empty()) { std::cerr << "no successful requests (is the server running?)\n"; return 1; }
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+    std::cout << "requests=" << all.size() << " concurrency=" << concurrency << " bits=" << bits
+              << " moduli=" << moduli << " req/s=" << all.size() / el << '\n'
+              << "latency_us p50=" << pct(0.50) << " p90=" << pct(0.90) << " p99=" << pct(0.99)
+              << " max=" << all.back() << '\n';
+    if (failures || wrong) {
+        std::cerr << failures << " failed, " << wrong << " wrong answers\n";
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace rsad
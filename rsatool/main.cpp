@@ -0,0 +1,447 @@
+// rsatool: the three project operations (and key generation) in one binary
+// on the shared BigInt library, so callers can push many operations through
+// one process instead of paying process start-up per number.
+//
+//   rsatool isprime <in> <out>          every n        -> 1 / 0
+//   rsatool keyinv  <in> <out>          every p q e    -> d / -1
+//   rsatool modexp  <in> <out> [lanes]  every N k x    -> x^k mod N (pipelined)
+//   rsatool keygen  <bits> <out> [e]    n e d p q, one per line (e defaults to 65537)
+//   rsatool run     <in> <out>          mixed stream, see runStream()
+//   rsatool batchgcd <in> <out> [workers] [memory MiB]
+//                                       every N -> shared factor / 1, see batchgcd.h
+//   rsatool factor  <in> <out> [seconds] [threads]
+//                                       every n -> its prime factors, see factor.h
+//   rsatool batchrsa <in> <out>         every p q b e_1..e_b c_1..c_b -> c_i^(1/e_i) mod pq,
+//                                       Fiat's batch RSA, see batchrsa.h
+//   rsatool safeprime <bits> <out> [threads]      p q with p = 2q + 1, see primegen.h
+//   rsatool strongprime <bits> <out> [threads]    p r s t (Gordon: r | p - 1, s | p + 1, t | r - 1)
+//   rsatool serve   <socket> [workers] [cache]           compute daemon, see daemon.h
+//   rsatool load    <socket> [requests] [conc] [bits] [moduli]   load generator for it
+//   rsatool selftest                    library checks, see selftest.h
+//
+// Numbers are LSB-first hex as in the project tools; isprime/keyinv/modexp
+// also take binary record files (common/binrec.h) and answer in kind. With a
+// single record they behave exactly like project_01_01/02/03.
+//
+// With $RSA_CACHE set, isprime, keyinv, modexp and run memoize their answers
+// in that file across runs (common/resultcache.h) and report hits and misses.
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <thread>
+#include <iostream>
+#include "../common/bigint.h"
+#include "../common/rsa.h"
+#include "../common/modexp.h"
+#include "../common/binrec.h"
+#include "../common/batchgcd.h"
+#include "../common/factor.h"
+#include "../common/batchrsa.h"
+#include "../common/primegen.h"
+#include "../common/resultcache.h"
+#include "daemon.h"
+#include "selftest.h"
+
+using namespace std;
+
+static const uint64_t DEFAULT_E = 65537;
+static const int MAX_KEY_BITS = 16384;
+
+// Reads every number in the file; false if it cannot be opened. Parsing
+// is the PARSE phase, what follows it COMPUTE until finish() (EMIT).
+static bool readAll(binrec::NumberInput& in, const char* path, vector<BigInt>& nums) {
+    INSTRUMENT_PHASE(PARSE);
+    if (!in.open(path)) { cerr << "Cannot open input: " << path << '\n'; return false; }
+    BigInt n;
+    while (in.read(n)) nums.push_back(n);
+    INSTRUMENT_PHASE(COMPUTE);
+    return true;
+}
+
+static bool finish(binrec::NumberOutput& out, const char* path) {
+    INSTRUMENT_PHASE(EMIT);
+    if (out.close()) return true;
+    cerr << "Cannot write output: " << path << '\n';
+    return false;
+}
+
+// 1 / 0, through the cache when there is one.
+static BigInt cachedIsPrime(resultcache::Log* cache, const BigInt& n) {
+    return resultcache::memo(cache, resultcache::fingerprint(resultcache::IS_PRIME, {&n}),
+                             [&] { return BigInt(isPrime(n) ? 1 : 0); });
+}
+
+// d, or 0 for no inverse.
+static BigInt cachedKeyInv(resultcache::Log* cache, const BigInt& p, const BigInt& q, const BigInt& e) {
+    return resultcache::memo(cache, resultcache::fingerprint(resultcache::KEY_INV, {&p, &q, &e}),
+                             [&] { return modInverse(e, phiEuler(p, q)); });
+}
+
+// Cache hits for the jobs' answers; the misses go through the lane engine
+// together and are stored. Without a cache, just the lane engine.
+static void cachedModExp(resultcache::Log* cache, vector<ModExpJob>& jobs, int lanes) {
+    vector<resultcache::Key> keys(jobs.size());
+    vector<ModExpJob> todo;
+    vector<size_t> slot;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (cache) {
+            keys[i] = resultcache::fingerprint(resultcache::MOD_EXP, {&jobs[i].N, &jobs[i].k, &jobs[i].x});
+            if (cache->find(keys[i], jobs[i].y)) continue;
+        }
+        slot.push_back(i);
+        todo.push_back(jobs[i]);
+    }
+    LaneModExp::run(todo, lanes);
+    for (size_t j = 0; j < slot.size(); ++j) {
+        if (cache) cache->store(keys[slot[j]], todo[j].y);
+        jobs[slot[j]].y = std::move(todo[j].y);
+    }
+}
+
+static int cmdIsPrime(const char* inPath, const char* outPath) {
+    binrec::NumberInput in; vector<BigInt> nums;
+    if (!readAll(in, inPath, nums)) return 1;
+    if (nums.empty()) nums.emplace_back();         // as project_01_01: n = 0
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), nums.size())) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    resultcache::Log* cache = resultcache::fromEnv();
+    for (auto& n : nums) out.write(cachedIsPrime(cache, n));
+    return finish(out, outPath) ? 0 : 1;
+}
+
+static int cmdKeyInv(const char* inPath, const char* outPath) {
+    binrec::NumberInput in; vector<BigInt> nums;
+    if (!readAll(in, inPath, nums)) return 1;
+    size_t count = max<size_t>(nums.size() / 3, 1);
+    nums.resize(3 * count);                       // a short record reads as zeros
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), count)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    resultcache::Log* cache = resultcache::fromEnv();
+    for (size_t i = 0; i < count; ++i) {
+        BigInt d = cachedKeyInv(cache, nums[3 * i], nums[3 * i + 1], nums[3 * i + 2]);
+        if (d.isZero()) out.writeNone(); else out.write(d);
+    }
+    return finish(out, outPath) ? 0 : 1;
+}
+
+// Streams through the pipelined engine, so parsing and formatting overlap
+// the arithmetic; the stage report goes to stderr. With a cache the whole
+// file is read first, so only the misses reach the engine.
+static int cmdModExp(const char* inPath, const char* outPath, int lanes) {
+    binrec::NumberInput in;
+    if (!in.open(inPath)) { cerr << "Cannot open input: " << inPath << '\n'; return 1; }
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), (in.count() + 2) / 3)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    lanes = lanes < 0 ? detectLanes() : min(lanes, detectLanes());
+    if (resultcache::Log* cache = resultcache::fromEnv()) {
+        vector<ModExpJob> jobs;
+        INSTRUMENT_PHASE(PARSE);
+        for (;;) {
+            ModExpJob j;
+            if (!in.read(j.N)) break;
+            in.read(j.k) && in.read(j.x);          // a short record reads as zeros
+            jobs.push_back(j);
+        }
+        INSTRUMENT_PHASE(COMPUTE);
+        cachedModExp(cache, jobs, lanes);
+        for (auto& j : jobs) out.write(j.y);
+        return finish(out, outPath) ? 0 : 1;
+    }
+    int workers = max(1, (int)thread::hardware_concurrency());
+    streamModExp(in, out, lanes, workers).print(cerr);
+    return finish(out, outPath) ? 0 : 1;
+}
+
+// Corpus audit: one answer per modulus, the factor it shares with some other
+// modulus of the file (the modulus itself if duplicated), 1 if none, and -1
+// for entries below 2.
+static int cmdBatchGcd(const char* inPath, const char* outPath, int workers, size_t memoryMiB) {
+    binrec::NumberInput in; vector<BigInt> nums;
+    if (!readAll(in, inPath, nums)) return 1;
+    vector<BigInt> moduli, g;
+    vector<size_t> slot(nums.size(), SIZE_MAX);
+    for (size_t i = 0; i < nums.size(); ++i)
+        if (!(nums[i] < BigInt(2))) { slot[i] = moduli.size(); moduli.push_back(nums[i]); }
+    batchgcd::Options opt;
+    opt.workers = workers;
+    opt.memoryBytes = memoryMiB << 20;
+    if (const char* dir = getenv("TMPDIR")) opt.spillDir = dir;
+    batchgcd::Stats st;
+    if (!batchgcd::run(moduli, g, opt, &st)) { cerr << "batchgcd: cannot spill to " << opt.spillDir << '\n'; return 1; }
+    batchgcd::resolveWhole(moduli, g);
+    size_t weak = 0;
+    for (auto& x : g) weak += !x.isOne();
+    cerr << "batchgcd: " << moduli.size() << " moduli, " << weak << " share a factor; "
+         << st.levels << " levels (" << st.spilled << " spilled), peak " << (st.peakBytes >> 20)
+         << " MiB; product " << st.productSeconds << " s, remainder " << st.remainderSeconds
+         << " s, leaves " << st.leafSeconds << " s\n";
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), nums.size())) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    for (size_t s : slot) {
+        if (s == SIZE_MAX) out.writeNone(); else out.write(g[s]);
+    }
+    return finish(out, outPath) ? 0 : 1;
+}
+
+// One text line per n (either input format): its prime factors ascending,
+// space-separated, repeated by multiplicity; if the time budget ran out on a
+// composite part, "/" and that cofactor close the line. -1 for n < 2.
+static int cmdFactor(const char* inPath, const char* outPath, double seconds, int threads) {
+    binrec::NumberInput in; vector<BigInt> nums;
+    if (!readAll(in, inPath, nums)) return 1;
+    fastio::BufferedOutput out;
+    if (!out.open(outPath)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    factor::Options opt;
+    opt.seconds = seconds;
+    opt.threads = threads;
+    size_t partial = 0;
+    for (auto& n : nums) {
+        if (n < BigInt(2)) { out << "-1\n"; continue; }
+        factor::Result r = factor::factorize(n, opt);
+        for (size_t i = 0; i < r.primes.size(); ++i) out << (i ? " " : "") << r.primes[i];
+        if (!r.cofactor.isOne()) { out << (r.primes.empty() ? "/ " : " / ") << r.cofactor; ++partial; }
+        out << '\n';
+    }
+    if (partial) cerr << "factor: " << partial << " of " << nums.size() << " left a composite cofactor\n";
+    if (!out.close()) { cerr << "Cannot write output: " << outPath << '\n'; return 1; }
+    return 0;
+}
+
+// Private operations batched per key: each group is p, q, the count b, b
+// pairwise coprime public exponents and b ciphertexts (c_i under e_i), and
+// gets b answers in order. A key the batch cannot use (p == q, an exponent
+// below 3, shared factors) answers -1 for each of its ciphertexts.
+static int cmdBatchRsa(const char* inPath, const char* outPath) {
+    binrec::NumberInput in; vector<BigInt> nums;
+    if (!readAll(in, inPath, nums)) return 1;
+    vector<size_t> groups;                         // offset of every group
+    size_t answers = 0;
+    for (size_t i = 0; i < nums.size();) {
+        size_t b = i + 2 < nums.size() && nums[i + 2].bitLength() <= 16 ? nums[i + 2].words()[0] : 0;
+        if (b == 0 || nums.size() - i < 3 + 2 * b) {
+            cerr << "batchrsa: group " << groups.size() << " is truncated or has no ciphertexts\n";
+            return 1;
+        }
+        groups.push_back(i);
+        answers += b;
+        i += 3 + 2 * b;
+    }
+    binrec::NumberOutput out;
+    if (!out.open(outPath, in.binary(), answers)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    for (size_t g : groups) {
+        size_t b = nums[g + 2].words()[0];
+        vector<BigInt> e(nums.begin() + g + 3, nums.begin() + g + 3 + b);
+        vector<BigInt> c(nums.begin() + g + 3 + b, nums.begin() + g + 3 + 2 * b), m;
+        batchrsa::Batch batch(nums[g], nums[g + 1], e);
+        if (!batch.valid()) { for (size_t i = 0; i < b; ++i) out.writeNone(); continue; }
+        batch.decrypt(c, m);
+        for (auto& x : m) out.write(x);
+    }
+    return finish(out, outPath) ? 0 : 1;
+}
+
+static bool parseBits(const char* s, int& bits) {
+    char* end;
+    long v = strtol(s, &end, 10);
+    if (*end || v < 16 || v > MAX_KEY_BITS) return false;
+    bits = (int)v;
+    return true;
+}
+
+static void writeKey(fastio::BufferedOutput& out, const RsaKey& k, char sep) {
+    out << k.n << sep << k.e << sep << k.d << sep << k.p << sep << k.q << '\n';
+}
+
+static int cmdKeygen(const char* bitsArg, const char* outPath, const char* eArg) {
+    int bits;
+    if (!parseBits(bitsArg, bits)) { cerr << "keygen: bits must be 16.." << MAX_KEY_BITS << '\n'; return 1; }
+    BigInt e = eArg ? BigInt(string(eArg)) : BigInt(DEFAULT_E);
+    if (e.isEven() || e < BigInt(3)) { cerr << "keygen: e must be odd and >= 3\n"; return 1; }
+    RsaKey k = generateKey(bits, e);
+    fastio::BufferedOutput out;
+    if (!out.open(outPath)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    writeKey(out, k, '\n');
+    if (!out.close()) { cerr << "Cannot write output: " << outPath << '\n'; return 1; }
+    return 0;
+}
+
+// Safe (p = 2q + 1) or Gordon strong prime, one number per line.
+static int cmdPrimeGen(bool safe, const char* bitsArg, const char* outPath, int threads) {
+    const char* name = safe ? "safeprime" : "strongprime";
+    int bits, minBits = safe ? primegen::SAFE_MIN_BITS : primegen::STRONG_MIN_BITS;
+    if (!parseBits(bitsArg, bits) || bits < minBits) { cerr << name << ": bits must be " << minBits << ".." << MAX_KEY_BITS << '\n'; return 1; }
+    vector<BigInt> nums;
+    if (safe) {
+        BigInt p = primegen::safePrime(bits, threads);
+        nums = {p, p.shiftRight(1)};
+    } else {
+        primegen::StrongPrime sp = primegen::strongPrime(bits, threads);
+        nums = {sp.p, sp.r, sp.s, sp.t};
+    }
+    fastio::BufferedOutput out;
+    if (!out.open(outPath)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    for (auto& x : nums) out << x << '\n';
+    if (!out.close()) { cerr << "Cannot write output: " << outPath << '\n'; return 1; }
+    return 0;
+}
+
+// Mixed operation stream (text): each record is an operation name followed
+// by its operands, whitespace-separated, and yields one output line:
+//   isprime n          -> 1 / 0
+//   keyinv p q e       -> d / -1
+//   modexp N k x       -> x^k mod N
+//   keygen bits e      -> n e d p q   (bits in decimal, the rest hex)
+// All modexp records of the stream go through the lane engine together; the
+// output keeps the input order.
+static int runStream(const char* inPath, const char* outPath) {
+    enum Kind { IS_PRIME, KEY_INV, MOD_EXP, KEYGEN };
+    struct Op { Kind kind; BigInt a, b, c; int bits; size_t job; };   // job: index into jobs / keys
+    INSTRUMENT_PHASE(PARSE);
+    fastio::MappedInput in;
+    if (!in.open(inPath)) { cerr << "Cannot open input: " << inPath << '\n'; return 1; }
+
+    vector<Op> ops;
+    vector<ModExpJob> jobs;
+    const char* tok; size_t len;
+    auto operand = [&](BigInt& n) {
+        if (!in.next(tok, len)) return false;
+        n.assignHex(tok, len);
+        return true;
+    };
+    while (in.next(tok, len)) {
+        string name(tok, len);
+        Op op{};
+        bool ok;
+        if (name == "isprime") { op.kind = IS_PRIME; ok = operand(op.a); }
+        else if (name == "keyinv") { op.kind = KEY_INV; ok = operand(op.a) && operand(op.b) && operand(op.c); }
+        else if (name == "modexp") {
+            op.kind = MOD_EXP; op.job = jobs.size();
+            jobs.emplace_back();
+            ok = operand(jobs.back().N) && operand(jobs.back().k) && operand(jobs.back().x);
+        } else if (name == "keygen") {
+            op.kind = KEYGEN;
+            ok = in.next(tok, len) && parseBits(string(tok, len).c_str(), op.bits) && operand(op.a);
+            if (ok && (op.a.isEven() || op.a < BigInt(3))) {
+                cerr << "record " << ops.size() << ": keygen e must be odd and >= 3\n";
+                return 1;
+            }
+        } else {
+            cerr << "record " << ops.size() << ": unknown operation '" << name << "'\n";
+            return 1;
+        }
+        if (!ok) { cerr << "record " << ops.size() << ": bad or missing operands for " << name << '\n'; return 1; }
+        ops.push_back(op);
+    }
+
+    INSTRUMENT_PHASE(COMPUTE);
+    resultcache::Log* cache = resultcache::fromEnv();
+    cachedModExp(cache, jobs, detectLanes());
+    vector<BigInt> answers(ops.size());                // isprime / keyinv; modexp stays in jobs
+    vector<RsaKey> keys;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        Op& op = ops[i];
+        switch (op.kind) {
+        case IS_PRIME: answers[i] = cachedIsPrime(cache, op.a); break;
+        case KEY_INV: answers[i] = cachedKeyInv(cache, op.a, op.b, op.c); break;
+        case MOD_EXP: break;
+        case KEYGEN: op.job = keys.size(); keys.push_back(generateKey(op.bits, op.a)); break;
+        }
+    }
+
+    INSTRUMENT_PHASE(EMIT);
+    fastio::BufferedOutput out;
+    if (!out.open(outPath)) { cerr << "Cannot open output: " << outPath << '\n'; return 1; }
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const Op& op = ops[i];
+        switch (op.kind) {
+        case IS_PRIME: out << answers[i] << '\n'; break;
+        case KEY_INV:
+            if (answers[i].isZero()) out << "-1"; else out << answers[i];
+            out << '\n';
+            break;
+        case MOD_EXP: out << jobs[op.job].y << '\n'; break;
+        case KEYGEN: writeKey(out, keys[op.job], ' '); break;
+        }
+    }
+    if (!out.close()) { cerr << "Cannot write output: " << outPath << '\n'; return 1; }
+    return 0;
+}
+
+// rsatool selftest's checks of the run command: a good stream and records
+// it must refuse rather than hang on (keygen with an unusable e).
+static void streamChecks(rsatest::Checks& c) {
+    string base = string(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp") + "/selftest-run-" + to_string(getpid());
+    string inPath = base + ".inp", outPath = base + ".out";
+    auto runOn = [&](const char* text) {
+        FILE* f = fopen(inPath.c_str(), "w");
+        if (f) { fputs(text, f); fclose(f); }
+        streambuf* err = cerr.rdbuf(nullptr);          // the refusals are expected
+        int rc = runStream(inPath.c_str(), outPath.c_str());
+        cerr.rdbuf(err);
+        return rc;
+    };
+    c.expect(runOn("isprime D\nkeygen 64 3\nmodexp D 3 2\n") == 0, "run: good stream failed");
+    for (const char* e : {"2", "1", "0", "E0001"})             // E0001 is 0x1000E, even
+        c.expect(runOn(("isprime D\nkeygen 64 " + string(e) + "\n").c_str()) == 1,
+                 string("run: keygen with e = ") + e + " not refused");
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+}
+
+static int usage(const char* prog) {
+    cerr << "Usage: " << prog << " isprime <input> <output>\n"
+         << "       " << prog << " keyinv <input> <output>\n"
+         << "       " << prog << " modexp <input> <output> [lanes: 0|4|8]\n"
+         << "       " << prog << " keygen <bits> <output> [e]\n"
+         << "       " << prog << " run <input> <output>\n"
+         << "       " << prog << " batchgcd <input> <output> [workers] [memory MiB]\n"
+         << "       " << prog << " factor <input> <output> [seconds per number] [threads]\n"
+         << "       " << prog << " batchrsa <input> <output>\n"
+         << "       " << prog << " safeprime <bits> <output> [threads]\n"
+         << "       " << prog << " strongprime <bits> <output> [threads]\n"
+         << "       " << prog << " serve <socket> [workers] [cache entries]\n"
+         << "       " << prog << " load <socket> [requests] [concurrency] [bits] [moduli]\n"
+         << "       " << prog << " selftest\n";
+    return 1;
+}
+
+static int dispatch(int argc, char* argv[]);
+
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false);
+    srand((unsigned)time(0));
+    int rc = dispatch(argc, argv);
+    string cmd = argc >= 2 ? argv[1] : "";
+    bool cached = cmd == "isprime" || cmd == "keyinv" || cmd == "modexp" || cmd == "run";
+    if (resultcache::Log* cache = cached ? resultcache::fromEnv() : nullptr) cache->report(cerr);
+    return rc;
+}
+
+static int dispatch(int argc, char* argv[]) {
+    string cmd = argc >= 2 ? argv[1] : "";
+    auto intArg = [&](int i, int def) { return argc > i ? atoi(argv[i]) : def; };
+    if (cmd == "serve" && argc >= 3 && argc <= 5)
+        return rsad::Server(intArg(3, (int)thread::hardware_concurrency()), intArg(4, 64)).run(argv[2]);
+    if (cmd == "load" && argc >= 3 && argc <= 7)
+        return rsad::runLoad(argv[2], intArg(3, 10000), max(1, intArg(4, 4)), max(64, intArg(5, 2048)), max(1, intArg(6, 16)));
+    if (cmd == "selftest" && argc == 2) return rsatest::run(streamChecks) ? 1 : 0;
+    if (argc < 4) return usage(argv[0]);
+    if (cmd == "isprime" && argc == 4) return cmdIsPrime(argv[2], argv[3]);
+    if (cmd == "keyinv" && argc == 4) return cmdKeyInv(argv[2], argv[3]);
+    if (cmd == "modexp" && (argc == 4 || argc == 5)) return cmdModExp(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : -1);
+    if (cmd == "keygen" && (argc == 4 || argc == 5)) return cmdKeygen(argv[2], argv[3], argc == 5 ? argv[4] : nullptr);
+    if (cmd == "run" && argc == 4) return runStream(argv[2], argv[3]);
+    if (cmd == "batchgcd" && argc >= 4 && argc <= 6)
+        return cmdBatchGcd(argv[2], argv[3], max(1, intArg(4, (int)thread::hardware_concurrency())),
+                           (size_t)max(1, intArg(5, 1024)));
+    if (cmd == "factor" && argc >= 4 && argc <= 6)
+        return cmdFactor(argv[2], argv[3], argc > 4 ? max(0.0, atof(argv[4])) : 10.0,
+                         max(1, intArg(5, (int)thread::hardware_concurrency())));
+    if (cmd == "batchrsa" && argc == 4) return cmdBatchRsa(argv[2], argv[3]);
+    if ((cmd == "safeprime" || cmd == "strongprime") && (argc == 4 || argc == 5))
+        return cmdPrimeGen(cmd == "safeprime", argv[2], argv[3], max(1, intArg(4, (int)thread::hardware_concurrency())));
+    return usage(argv[0]);
+}
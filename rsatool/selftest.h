@@ -0,0 +1,193 @@
+// rsatool selftest: checks of the common/ library features rsatool is built
+// on, each against a plain reference computation. Prints the case count and
+// returns the number of mismatches.
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../common/bigint.h"
+#include "../common/rsa.h"
+#include "../common/modexp.h"
+#include "../common/batchrsa.h"
+#include "../common/blinding.h"
+#include "../common/primegen.h"
+#include "../common/resultcache.h"
+
+namespace rsatest {
+
+struct Checks {
+    int cases = 0, bad = 0;
+
+    // Counts one case; a failed one is reported on stderr.
+    void expect(bool ok, const std::string& what) {
+        ++cases;
+        if (!ok) { ++bad; std::cerr << what << '\n'; }
+    }
+};
+
+// Random value below 2^bits.
+inline BigInt randomBits(std::mt19937_64& rng, int bits) {
+    BigInt r;
+    for (int i = 0; i < bits; ++i) if (rng() & 1) r.setBit(i);
+    return r;
+}
+
+// Moving from an inline value leaves 0 with every limb clear, so growing
+// the moved-from value again starts from 0.
+inline void bigIntMoves(Checks& c) {
+    BigInt src(std::string("FFFFFFFFFFFFFFFFFFFFFFFF")), want = src;
+    BigInt dst(std::move(src));
+    c.expect(dst == want && src.isZero(), "move from inline value: source not left 0");
+    src += BigInt(1);
+    c.expect(src == BigInt(1), "move from inline value: source + 1 != 1");
+}
+
+// swap() between a short and a long value (inline and pooled), then growing
+// both: each must behave like a fresh copy of the value it received.
+inline void bigIntSwaps(Checks& c, std::mt19937_64& rng) {
+    for (int longBits : {96, 256, 700}) {
+        BigInt shortV(0xFF), longV = randomBits(rng, longBits);
+        longV.setBit(longBits - 1);
+        BigInt step = BigInt(1).shiftLeft(32);
+        BigInt a = shortV, b = longV, x = shortV, y = longV;
+        a.swap(b);
+        y.swap(x);
+        a += step; b += step; x <<= 33; y <<= 33;
+        c.expect(a == longV + step && b == shortV + step && x == longV.shiftLeft(33) && y == shortV.shiftLeft(33),
+                 "swap then grow mismatch: " + std::to_string(longBits) + " bits");
+    }
+}
+
+// Fiat batch RSA against one CRT operation per ciphertext, with an odd
+// one out in the tree (b = 3, 5).
+inline void batchRsa(Checks& c, std::mt19937_64& rng) {
+    std::random_device rd;
+    BigInt all((uint64_t)3 * 5 * 7 * 11 * 13);
+    BigInt p = randomPrime(384, all, rd), q = randomPrime(384, all, rd);
+    for (size_t b : {1, 3, 5}) {
+        std::vector<BigInt> e, ct, m;
+        for (uint64_t x : {3, 5, 7, 11, 13}) if (e.size() < b) e.emplace_back(x);
+        batchrsa::Batch batch(p, q, e);
+        for (auto& x : e) ct.push_back(BigInt::powerMod<MontgomeryReducer>(randomBits(rng, 700), x, batch.modulus()));
+        batch.decrypt(ct, m);
+        for (size_t i = 0; i < b; ++i)
+            c.expect(batch.valid() && m[i] == batch.decryptOne(i, ct[i])
+                         && BigInt::powerMod<MontgomeryReducer>(m[i], e[i], batch.modulus()) == ct[i],
+                     "batch rsa mismatch: b=" + std::to_string(b) + " i=" + std::to_string(i));
+    }
+}
+
+// Blinded private operations from four threads on one key: each thread
+// has its own context (all four are alive at once, so the addresses
+// differ), every answer must match the unblinded one.
+inline void blindingThreads(Checks& c, std::mt19937_64& rng) {
+    RsaKey key = generateKey(512, BigInt(65537));
+    std::vector<BigInt> xs;
+    for (int i = 0; i < 8; ++i) xs.push_back(randomBits(rng, 500));
+    std::vector<int> wrong(4, 0);
+    std::vector<const blinding::Context*> used(4);
+    std::atomic<int> finished{0};
+    std::vector<std::thread> pool;
+    for (int t = 0; t < 4; ++t) pool.emplace_back([&, t] {
+        blinding::Context& ctx = blinding::local(key.n, key.e);
+        used[t] = &ctx;
+        for (int i = 0; i < 40; ++i) {
+            const BigInt& x = xs[(t + i) % xs.size()];
+            BigInt y = blinding::apply(ctx, x, [&](const BigInt& v) { return powerModBest(v, key.d, key.n); });
+            wrong[t] += !(y == powerModBest(x, key.d, key.n));
+        }
+        ++finished;
+        while (finished < 4) std::this_thread::yield();
+    });
+    for (auto& th : pool) th.join();
+    for (int t = 0; t < 4; ++t)
+        c.expect(!wrong[t] && std::count(used.begin(), used.end(), used[t]) == 1,
+                 "blinding mismatch: thread " + std::to_string(t));
+}
+
+// Generated primes hold their stated structure, and the joint sieve
+// strikes exactly the terms with a small factor in q or 2q + 1.
+inline void primeGen(Checks& c, std::mt19937_64& rng) {
+    BigInt q = randomBits(rng, 200), step(6);
+    q.setBit(199); q.setBit(0);
+    std::vector<bool> alive;
+    primegen::sieve(q, step, true, alive);
+    size_t mismatch = 1000;
+    for (size_t j = 0; j < 1000 && mismatch == 1000; ++j, q += step) {
+        bool clean = true;
+        for (uint32_t s : primegen::smallPrimes())
+            if (factor::modSmall(q, s) == 0 || factor::modSmall(q.shiftLeft(1) + BigInt(1), s) == 0) { clean = false; break; }
+        if (clean != alive[j]) mismatch = j;
+    }
+    c.expect(mismatch == 1000, "safe sieve mismatch at term " + std::to_string(mismatch));
+    BigInt p = primegen::safePrime(256, 2);
+    c.expect(p.bitLength() == 256 && isPrime(p) && isPrime(p.shiftRight(1)), "safe prime wrong: 256 bits");
+    primegen::StrongPrime sp = primegen::strongPrime(primegen::STRONG_MIN_BITS, 2);
+    BigInt one(1);
+    c.expect(sp.p.bitLength() == primegen::STRONG_MIN_BITS && isPrime(sp.p) && isPrime(sp.r) && isPrime(sp.s)
+                 && isPrime(sp.t) && sp.t.bitLength() >= primegen::SAFE_MIN_BITS && ((sp.p - one) % sp.r).isZero()
+                 && ((sp.p + one) % sp.s).isZero() && ((sp.r - one) % sp.t).isZero(),
+             "strong prime wrong: " + std::to_string(primegen::STRONG_MIN_BITS) + " bits");
+    sp = primegen::strongPrime(384, 2);
+    c.expect(sp.p.bitLength() == 384 && isPrime(sp.p) && ((sp.p - one) % sp.r).isZero()
+                 && ((sp.p + one) % sp.s).isZero() && ((sp.r - one) % sp.t).isZero(),
+             "strong prime wrong: 384 bits");
+}
+
+// Result cache: four threads store and look up at once, a reopened log
+// finds every value, and a torn record at the end is dropped.
+inline void resultCache(Checks& c, std::mt19937_64& rng) {
+    std::string path = std::string(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp") + "/selftest-" + std::to_string(rng()) + ".cache";
+    std::vector<BigInt> vals;
+    for (int i = 0; i < 400; ++i) vals.push_back(randomBits(rng, 1 + i * 7 % 900));
+    auto key = [&](int i) { BigInt n((uint64_t)i); return resultcache::fingerprint(resultcache::MOD_EXP, {&n, &vals[i]}); };
+    std::atomic<int> wrong{0};
+    {
+        resultcache::Log log;
+        log.open(path);
+        std::vector<std::thread> pool;
+        for (int t = 0; t < 4; ++t) pool.emplace_back([&, t] {
+            for (int i = t; i < (int)vals.size(); i += 4) log.store(key(i), vals[i]);
+            for (int i = 0; i < (int)vals.size(); ++i) {
+                BigInt v;
+                if (log.find(key(i), v) && !(v == vals[i])) ++wrong;
+            }
+        });
+        for (auto& th : pool) th.join();
+    }
+    { FILE* f = fopen(path.c_str(), "ab"); if (f) { fputs("torn", f); fclose(f); } }
+    resultcache::Log log;
+    if (!log.open(path)) wrong = 1;
+    for (int i = 0; i < (int)vals.size(); ++i) {
+        BigInt v;
+        if (!log.find(key(i), v) || !(v == vals[i])) ++wrong;
+    }
+    log.close();
+    remove(path.c_str());
+    c.expect(!wrong, "result cache: " + std::to_string(wrong) + " wrong or missing values");
+}
+
+// `more` adds the checks that live with the tool itself (rsatool run).
+inline int run(void (*more)(Checks&) = nullptr) {
+    Checks c;
+    std::mt19937_64 rng(12345);
+    bigIntMoves(c);
+    bigIntSwaps(c, rng);
+    batchRsa(c, rng);
+    blindingThreads(c, rng);
+    primeGen(c, rng);
+    resultCache(c, rng);
+    if (more) more(c);
+    std::cout << "selftest: " << c.cases << " cases, " << c.bad << " mismatches\n";
+    return c.bad;
+}
+
+} // namespace rsatest